@@ -1,45 +1,234 @@
 #include <gtest/gtest.h>
-#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+#include "mapped_file.h"
+#include "scan.h"
 
 namespace day1 {
 
-    TEST(Day1, Part1) {
-        std::ifstream input;
-        input.open("../../test/input/day1.txt");
-        std::string line;
-        auto sum = 0;
-        auto largestSum = 0;
-        while (std::getline(input, line)) {
-            if (line.empty()) {
-                largestSum = std::max(largestSum, sum);
-                sum = 0;
+    /**
+     * Keeps the k largest values offered so far in a min-heap, so each offer is O(log k) and nothing else
+     * is stored.
+     */
+    class top_k {
+    private:
+        size_t k;
+        std::vector<long long> heap;
+
+    public:
+        explicit top_k(size_t k) : k(k) {}
+
+        void offer(long long value) {
+            if (heap.size() < k) {
+                heap.push_back(value);
+                std::push_heap(heap.begin(), heap.end(), std::greater<>());
+            } else if (k > 0 && value > heap.front()) {
+                std::pop_heap(heap.begin(), heap.end(), std::greater<>());
+                heap.back() = value;
+                std::push_heap(heap.begin(), heap.end(), std::greater<>());
+            }
+        }
+
+        /**
+         * Offers all of other's values, so merging per-chunk results gives the top k of the whole input.
+         */
+        void merge(const top_k &other) {
+            for (auto value: other.heap) {
+                offer(value);
+            }
+        }
+
+        /**
+         * Largest first.
+         */
+        [[nodiscard]] std::vector<long long> values() const {
+            std::vector<long long> result = heap;
+            std::sort(result.begin(), result.end(), std::greater<>());
+            return result;
+        }
+
+        [[nodiscard]] long long sum() const {
+            return std::accumulate(heap.begin(), heap.end(), 0LL);
+        }
+    };
+
+    /**
+     * Sums each blank-line-separated group of numbers in [begin, end) and keeps the k largest sums.
+     */
+    top_k total_calories(const char *begin, const char *end, size_t k) {
+        top_k best(k);
+        long long group_sum = 0;
+        bool in_group = false;
+        for_each_line(begin, end, [&](const char *line_begin, const char *line_end) {
+            if (line_end > line_begin && line_end[-1] == '\r') {
+                --line_end;
+            }
+            if (line_begin == line_end) {
+                if (in_group) {
+                    best.offer(group_sum);
+                }
+                group_sum = 0;
+                in_group = false;
             } else {
-                sum += stoi(line);
+                group_sum += (long long) parse_digits(line_begin, line_end, end);
+                in_group = true;
             }
+        });
+        if (in_group) {
+            best.offer(group_sum);
         }
-        std::cout << largestSum << "\n";
+        return best;
     }
 
-    TEST(Day1, Part2) {
-        std::ifstream input;
-        input.open("../../test/input/day1.txt");
-        std::string line;
-        auto sum = 0;
-        std::vector<int> counts;
-        while (std::getline(input, line)) {
-            if (line.empty()) {
-                counts.push_back(sum);
-                sum = 0;
-            } else {
-                sum += stoi(line);
+    /**
+     * First position at or after p that starts a group, i.e. just past a blank line, or end if there isn't one.
+     */
+    const char *next_group_start(const char *p, const char *end) {
+        while (p < end) {
+            auto newline = static_cast<const char *>(memchr(p, '\n', end - p));
+            if (newline == nullptr) {
+                return end;
+            }
+            p = newline + 1;
+            if (p < end && *p == '\r') {
+                ++p;
+            }
+            if (p < end && *p == '\n') {
+                return p + 1;
             }
         }
-        std::sort(counts.begin(), counts.end(), [](auto a, auto b) {
-            return a > b;
-        });
-        auto totalSum = 0;
-        std::for_each(counts.begin(), counts.begin() + 3, [&](auto a) { totalSum += a; });
-        std::cout << totalSum << "\n";
+        return end;
+    }
+
+    /**
+     * Same as total_calories, but splits the buffer into num_threads chunks that end on blank lines, so no group
+     * straddles two chunks, reduces each chunk on its own thread and merges the per-chunk results.
+     */
+    top_k total_calories_parallel(const char *begin, const char *end, size_t k, size_t num_threads) {
+        std::vector<const char *> boundaries{begin};
+        for (size_t i = 1; i < num_threads; ++i) {
+            auto target = std::max(boundaries.back(), begin + (end - begin) * i / num_threads);
+            boundaries.push_back(next_group_start(target, end));
+        }
+        boundaries.push_back(end);
+
+        std::vector<top_k> results(num_threads, top_k(k));
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < num_threads; ++i) {
+            threads.emplace_back([&, i]() {
+                results[i] = total_calories(boundaries[i], boundaries[i + 1], k);
+            });
+        }
+        for (auto &t: threads) {
+            t.join();
+        }
+
+        top_k best(k);
+        for (auto &result: results) {
+            best.merge(result);
+        }
+        return best;
+    }
+
+    /**
+     * Random input with the given number of groups of 1-15 numbers each.
+     */
+    std::string generate_input(size_t groups, unsigned seed) {
+        std::mt19937 random(seed);
+        std::uniform_int_distribution<int> group_size(1, 15);
+        std::uniform_int_distribution<int> calories(1, 99999);
+        std::string result;
+        for (size_t i = 0; i < groups; ++i) {
+            if (i > 0) {
+                result += '\n';
+            }
+            for (int n = group_size(random); n > 0; --n) {
+                result += std::to_string(calories(random));
+                result += '\n';
+            }
+        }
+        return result;
+    }
+
+    const std::string sample_input = "1000\n"
+                                     "2000\n"
+                                     "3000\n"
+                                     "\n"
+                                     "4000\n"
+                                     "\n"
+                                     "5000\n"
+                                     "6000\n"
+                                     "\n"
+                                     "7000\n"
+                                     "8000\n"
+                                     "9000\n"
+                                     "\n"
+                                     "10000";
+
+    TEST(Day1, total_calories) {
+        auto best = total_calories(sample_input.data(), sample_input.data() + sample_input.size(), 3);
+        ASSERT_EQ(best.values(), (std::vector<long long>{24000, 11000, 10000}));
+        ASSERT_EQ(best.sum(), 45000);
+
+        ASSERT_EQ(total_calories(sample_input.data(), sample_input.data() + sample_input.size(), 10).values(),
+                  (std::vector<long long>{24000, 11000, 10000, 6000, 4000}));
+
+        std::string windows_line_endings = "123456789\r\n1\r\n\r\n99999999\r\n";
+        ASSERT_EQ(total_calories(windows_line_endings.data(),
+                                 windows_line_endings.data() + windows_line_endings.size(), 2).values(),
+                  (std::vector<long long>{123456790, 99999999}));
+    }
+
+    TEST(Day1, total_calories_parallel) {
+        for (size_t threads = 1; threads <= 8; ++threads) {
+            auto best = total_calories_parallel(sample_input.data(), sample_input.data() + sample_input.size(), 3,
+                                                threads);
+            ASSERT_EQ(best.values(), (std::vector<long long>{24000, 11000, 10000}));
+        }
+
+        auto generated = generate_input(10000, 1);
+        auto expected = total_calories(generated.data(), generated.data() + generated.size(), 5).values();
+        for (size_t threads = 1; threads <= 16; ++threads) {
+            auto best = total_calories_parallel(generated.data(), generated.data() + generated.size(), 5, threads);
+            ASSERT_EQ(best.values(), expected);
+        }
+    }
+
+    TEST(Day1, DISABLED_parallel_benchmark) {
+        auto generated = generate_input(500000, 2);
+        const int iterations = 5;
+        auto p_as_float = (double) std::chrono::steady_clock::period::num / (double) std::chrono::steady_clock::period::den;
+
+        auto expected = total_calories(generated.data(), generated.data() + generated.size(), 3).sum();
+        std::cout << "input MB: " << generated.size() / (1024.0 * 1024.0) << std::endl;
+        for (size_t threads: {1, 2, 4, 8, 16}) {
+            long long sum = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                sum = total_calories_parallel(generated.data(), generated.data() + generated.size(), 3, threads).sum();
+            }
+            auto end = std::chrono::steady_clock::now();
+            std::cout << threads << " threads, seconds per run: "
+                      << ((end - start).count() * p_as_float / iterations) << std::endl;
+            EXPECT_EQ(sum, expected);
+        }
+    }
+
+    TEST(Day1, Part1) {
+        mapped_file input("../../test/input/day1.txt");
+        auto best = total_calories(input.begin(), input.end(), 1);
+        std::cout << best.sum() << "\n";
+    }
+
+    TEST(Day1, Part2) {
+        mapped_file input("../../test/input/day1.txt");
+        auto best = total_calories(input.begin(), input.end(), 3);
+        std::cout << best.sum() << "\n";
     }
 
-}
\ No newline at end of file
+}
@@ -1,6 +1,15 @@
 #include <gtest/gtest.h>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
 #include <fstream>
+#include <random>
 #include <regex>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include "mapped_file.h"
+#include "scan.h"
 
 using namespace std;
 
@@ -9,10 +18,297 @@ namespace day10 {
     const regex addx_regex("addx (-?\\d+)");
     const regex noop_regex("noop");
 
-    TEST(Day10, Part1) {
-        ifstream input;
-        input.open("../../test/input/day10.txt");
+    /**
+     * Each instruction is packed into one word: the low bit is the opcode and the rest is addx's operand.
+     */
+    enum opcode : int32_t {
+        noop = 0,
+        addx = 1
+    };
+
+    // The operands that fit in the 31 bits left over by the opcode
+    constexpr int32_t min_operand = -(1 << 30);
+    constexpr int32_t max_operand = (1 << 30) - 1;
+
+    constexpr int32_t encode(opcode op, int32_t operand = 0) {
+        return (int32_t) ((uint32_t) operand << 1) | op;
+    }
+
+    constexpr opcode opcode_of(int32_t instruction) {
+        return opcode(instruction & 1);
+    }
+
+    constexpr int32_t operand_of(int32_t instruction) {
+        return instruction >> 1;
+    }
+
+    vector<int32_t> parse_program(const char *begin, const char *end) {
+        vector<int32_t> program;
+        for_each_line(begin, end, [&](const char *line_begin, const char *line_end) {
+            if (line_end > line_begin && line_end[-1] == '\r') {
+                --line_end;
+            }
+            string_view line(line_begin, line_end - line_begin);
+            if (line.empty()) {
+                return;
+            }
+            if (line == "noop") {
+                program.push_back(encode(noop));
+            } else if (line.substr(0, 5) == "addx ") {
+                int32_t value;
+                auto [next, error] = from_chars(line_begin + 5, line_end, value);
+                if (error != errc() || next != line_end) {
+                    throw logic_error("invalid operand");
+                }
+                if (value < min_operand || value > max_operand) {
+                    throw logic_error("operand out of range");
+                }
+                program.push_back(encode(addx, value));
+            } else {
+                throw logic_error("invalid instruction");
+            }
+        });
+        return program;
+    }
+
+    /**
+     * Steps a decoded program one cycle at a time, writing the value of X during each cycle into a buffer
+     * supplied by the caller. The program can be run in as many pieces as the caller likes.
+     */
+    class cpu {
+    private:
+        const vector<int32_t> &program;
+        size_t pc{0};
+        // Whether the current addx has already used up its first cycle
+        bool mid_addx{false};
+        int x{1};
+
+    public:
+        explicit cpu(const vector<int32_t> &program) : program(program) {}
+
+        [[nodiscard]] bool done() const { return pc == program.size(); }
+
+        /**
+         * X after every cycle run so far.
+         */
+        [[nodiscard]] int register_x() const { return x; }
+
+        /**
+         * Runs up to size cycles, writing X during each one to out. Returns the number of cycles run, which is
+         * only less than size once the program has finished.
+         */
+        size_t run(int *out, size_t size) {
+            size_t written = 0;
+            while (written < size && pc < program.size()) {
+                auto instruction = program[pc];
+                out[written++] = x;
+                if (opcode_of(instruction) == addx && !mid_addx) {
+                    mid_addx = true;
+                    continue;
+                }
+                if (opcode_of(instruction) == addx) {
+                    x += operand_of(instruction);
+                }
+                mid_addx = false;
+                ++pc;
+            }
+            return written;
+        }
+    };
+
+    /**
+     * Calls f(cycle, x) for every cycle of the program, numbering cycles from 1.
+     */
+    template <typename F>
+    void for_each_cycle(const vector<int32_t> &program, F f) {
+        cpu machine(program);
+        int buffer[4096];
+        long long cycle = 1;
+        while (auto count = machine.run(buffer, size(buffer))) {
+            for (size_t i = 0; i < count; ++i, ++cycle) {
+                f(cycle, buffer[i]);
+            }
+        }
+    }
+
+    /**
+     * Sum of cycle * X over cycles 20, 60, 100 and so on.
+     */
+    long long signal_strength(const vector<int32_t> &program) {
+        long long result = 0;
+        for_each_cycle(program, [&](long long cycle, int x) {
+            if (cycle % 40 == 20) {
+                result += cycle * x;
+            }
+        });
+        return result;
+    }
+
+    /**
+     * One row of pixels for every width cycles the program runs. A pixel is lit when the sprite centered on X
+     * covers the column being drawn.
+     */
+    vector<string> render_crt(const vector<int32_t> &program, int width = 40) {
+        vector<string> rows;
+        for_each_cycle(program, [&](long long cycle, int x) {
+            auto column = (int) ((cycle - 1) % width);
+            if (column == 0) {
+                rows.emplace_back(width, '.');
+            }
+            if (abs(column - x) <= 1) {
+                rows.back()[column] = '#';
+            }
+        });
+        return rows;
+    }
+
+    /**
+     * X over the whole run of a program, without replaying it. X only changes when an addx finishes, so the
+     * history is a list of constant segments: segment i covers cycles starting at starts[i] up to the next
+     * start, and X is values[i] during all of them.
+     */
+    class x_history {
+    private:
+        vector<long long> starts{1};
+        vector<int> values{1};
+        long long _cycle_count{0};
+
+        [[nodiscard]] size_t segment_of(long long cycle) const {
+            if (cycle < 1 || cycle > _cycle_count) {
+                throw out_of_range("cycle " + to_string(cycle));
+            }
+            return upper_bound(starts.begin(), starts.end(), cycle) - starts.begin() - 1;
+        }
+
+        [[nodiscard]] long long segment_end(size_t segment) const {
+            return segment + 1 < starts.size() ? starts[segment + 1] - 1 : _cycle_count;
+        }
+
+    public:
+        explicit x_history(const vector<int32_t> &program) {
+            int x = 1;
+            for (auto instruction: program) {
+                if (opcode_of(instruction) == addx) {
+                    _cycle_count += 2;
+                    if (operand_of(instruction) != 0) {
+                        x += operand_of(instruction);
+                        starts.push_back(_cycle_count + 1);
+                        values.push_back(x);
+                    }
+                } else {
+                    _cycle_count += 1;
+                }
+            }
+            // The last change only matters after the program ends
+            if (starts.back() > _cycle_count) {
+                starts.pop_back();
+                values.pop_back();
+            }
+        }
+
+        [[nodiscard]] long long cycle_count() const { return _cycle_count; }
+
+        /**
+         * X during the given cycle, numbered from 1.
+         */
+        [[nodiscard]] int x_during(long long cycle) const {
+            return values[segment_of(cycle)];
+        }
+
+        /**
+         * Sum of cycle * X over an arbitrary set of cycles.
+         */
+        template <typename Iter>
+        [[nodiscard]] long long weighted_sum(Iter begin, Iter end) const {
+            long long result = 0;
+            for (auto iter = begin; iter != end; ++iter) {
+                result += *iter * (long long) x_during(*iter);
+            }
+            return result;
+        }
+
+        /**
+         * Sum of cycle * X over the cycles first, first + step, first + 2 * step and so on up to last. Works a
+         * segment at a time, summing the cycles that fall in each one in closed form, or a cycle at a time
+         * when that's fewer steps.
+         */
+        [[nodiscard]] long long weighted_sum(long long first, long long step, long long last) const {
+            if (step <= 0) {
+                throw invalid_argument("step must be positive");
+            }
+            if (last < first) {
+                return 0;
+            }
+            last = first + (last - first) / step * step;
+            auto first_segment = segment_of(first);
+            auto last_segment = segment_of(last);
+            auto terms = (last - first) / step + 1;
+
+            long long result = 0;
+            if ((long long) (last_segment - first_segment + 1) >= terms) {
+                for (auto cycle = first; cycle <= last; cycle += step) {
+                    result += cycle * (long long) x_during(cycle);
+                }
+                return result;
+            }
+            for (auto segment = first_segment; segment <= last_segment; ++segment) {
+                // Terms of the progression inside [lo, hi]
+                auto lo = max(first, starts[segment]);
+                auto hi = min(last, segment_end(segment));
+                auto a = first + (lo - first + step - 1) / step * step;
+                if (a > hi) {
+                    continue;
+                }
+                auto n = (hi - a) / step + 1;
+                auto b = a + (n - 1) * step;
+                result += (a + b) * n / 2 * values[segment];
+            }
+            return result;
+        }
 
+        /**
+         * Same as render_crt, but each scanline looks up X for its first pixel and then walks the segments
+         * forward, so rows are independent and are split across num_threads threads (at least one, and at most
+         * one per row).
+         */
+        [[nodiscard]] vector<string> render_crt(int width = 40, size_t num_threads = 4) const {
+            auto row_count = (size_t) ((_cycle_count + width - 1) / width);
+            vector<string> rows(row_count);
+            auto render_rows = [&](size_t first_row, size_t end_row) {
+                for (auto r = first_row; r < end_row; ++r) {
+                    auto first_cycle = (long long) r * width + 1;
+                    auto last_cycle = min(_cycle_count, first_cycle + width - 1);
+                    string row(width, '.');
+                    auto segment = segment_of(first_cycle);
+                    for (auto cycle = first_cycle; cycle <= last_cycle; ++cycle) {
+                        while (segment_end(segment) < cycle) {
+                            ++segment;
+                        }
+                        auto column = (int) (cycle - first_cycle);
+                        if (abs(column - values[segment]) <= 1) {
+                            row[column] = '#';
+                        }
+                    }
+                    rows[r] = std::move(row);
+                }
+            };
+            // at least one thread, and no more than there are rows to give them
+            num_threads = max<size_t>(1, min(num_threads, row_count));
+            vector<thread> threads;
+            for (size_t i = 0; i < num_threads; ++i) {
+                threads.emplace_back(render_rows, row_count * i / num_threads, row_count * (i + 1) / num_threads);
+            }
+            for (auto &t: threads) {
+                t.join();
+            }
+            return rows;
+        }
+    };
+
+    /**
+     * The original pending-lambda CPU, as a reference for signal_strength.
+     */
+    int signal_strength_with_lambdas(istream &input) {
         int x = 1;
         int cycle_number = 0;
         deque<function<void()>> pending;
@@ -47,58 +343,151 @@ namespace day10 {
             }
         }
 
-        cout << result << endl;
+        return result;
     }
 
-    TEST(Day10, Part2) {
-        ifstream input;
-        input.open("../../test/input/day10.txt");
+    /**
+     * A random program of noops and addx with small operands.
+     */
+    string generate_program(size_t length, unsigned seed) {
+        mt19937 random(seed);
+        string result;
+        for (size_t i = 0; i < length; ++i) {
+            if (random() % 3 == 0) {
+                result += "noop\n";
+            } else {
+                result += "addx " + to_string((int) (random() % 41) - 20) + "\n";
+            }
+        }
+        return result;
+    }
 
-        int x = 1;
-        int cycle_number = 0;
-        deque<function<void()>> pending;
+    TEST(Day10, cpu) {
+        string small = "noop\naddx 3\naddx -5\n";
+        auto program = parse_program(small.data(), small.data() + small.size());
+        ASSERT_EQ(program, (vector<int32_t>{encode(noop), encode(addx, 3), encode(addx, -5)}));
 
-        vector<string> result;
+        string extremes = "addx 1073741823\naddx -1073741824\n";
+        auto extreme_program = parse_program(extremes.data(), extremes.data() + extremes.size());
+        ASSERT_EQ(operand_of(extreme_program[0]), max_operand);
+        ASSERT_EQ(operand_of(extreme_program[1]), min_operand);
+        for (string bad: {"addx 1073741824\n", "addx -1073741825\n", "addx 4294967296\n"}) {
+            ASSERT_THROW(parse_program(bad.data(), bad.data() + bad.size()), logic_error);
+        }
 
-        while (true) {
-            cycle_number++;
+        // Running it a cycle at a time gives the same X values as one big run
+        cpu machine(program);
+        vector<int> xs;
+        int x;
+        while (machine.run(&x, 1) == 1) {
+            xs.push_back(x);
+        }
+        ASSERT_EQ(xs, (vector<int>{1, 1, 1, 4, 4}));
+        ASSERT_EQ(machine.register_x(), -1);
+        ASSERT_TRUE(machine.done());
 
-            int row_number = (cycle_number - 1) / 40;
-            int column_number = (cycle_number - 1) % 40;
+        for (unsigned seed = 1; seed <= 10; ++seed) {
+            auto source = generate_program(500, seed);
+            istringstream input(source);
+            program = parse_program(source.data(), source.data() + source.size());
+            ASSERT_EQ(signal_strength(program), signal_strength_with_lambdas(input));
+        }
+    }
 
-            if (result.size() <= row_number) {
-                result.emplace_back(40, '.');
-            }
+    TEST(Day10, DISABLED_cpu_benchmark) {
+        auto source = generate_program(2000000, 1);
+        auto p_as_float = (double) chrono::steady_clock::period::num / (double) chrono::steady_clock::period::den;
+        auto start = chrono::steady_clock::now();
+        auto program = parse_program(source.data(), source.data() + source.size());
+        auto strength = signal_strength(program);
+        auto end = chrono::steady_clock::now();
+        cout << "2000000 instructions, signal strength: " << strength << ", seconds: "
+             << ((end - start).count() * p_as_float) << endl;
+    }
 
-            if (abs(column_number - x) <= 1) {
-                result[row_number][column_number] = '#';
-            }
+    TEST(Day10, x_history) {
+        string small = "noop\naddx 3\naddx -5\naddx 0\n";
+        x_history small_history(parse_program(small.data(), small.data() + small.size()));
+        ASSERT_EQ(small_history.cycle_count(), 7);
+        vector<int> xs;
+        for (long long cycle = 1; cycle <= small_history.cycle_count(); ++cycle) {
+            xs.push_back(small_history.x_during(cycle));
+        }
+        ASSERT_EQ(xs, (vector<int>{1, 1, 1, 4, 4, -1, -1}));
+        ASSERT_THROW((void) small_history.x_during(0), out_of_range);
+        ASSERT_THROW((void) small_history.x_during(8), out_of_range);
 
-            if (!pending.empty()) {
-                auto todo = pending.front();
-                todo();
-                pending.pop_front();
-            } else {
+        for (unsigned seed = 1; seed <= 10; ++seed) {
+            auto source = generate_program(300 * seed, seed);
+            auto program = parse_program(source.data(), source.data() + source.size());
+            x_history history(program);
 
-                string line;
-                getline(input, line);
+            vector<int> replayed;
+            for_each_cycle(program, [&](long long, int x) { replayed.push_back(x); });
+            ASSERT_EQ(history.cycle_count(), replayed.size());
+            for (long long cycle = 1; cycle <= history.cycle_count(); ++cycle) {
+                ASSERT_EQ(history.x_during(cycle), replayed[cycle - 1]);
+            }
 
-                if (!input) {
-                    break;
+            auto last_signal = history.cycle_count() - (history.cycle_count() + 20) % 40;
+            ASSERT_EQ(history.weighted_sum(20, 40, last_signal), signal_strength(program));
+            for (long long step: {1, 2, 3, 7, 40, 1000}) {
+                long long expected = 0;
+                vector<long long> cycles;
+                for (long long cycle = 5; cycle <= history.cycle_count() - 3; cycle += step) {
+                    expected += cycle * replayed[cycle - 1];
+                    cycles.push_back(cycle);
                 }
+                ASSERT_EQ(history.weighted_sum(5, step, history.cycle_count() - 3), expected);
+                ASSERT_EQ(history.weighted_sum(cycles.begin(), cycles.end()), expected);
+            }
 
-                smatch match_result;
-                if (regex_match(line, match_result, addx_regex)) {
-                    auto value = stoi(match_result[1]);
-                    pending.emplace_back([=, &x]() { x += value; });
-                } else if (regex_match(line, match_result, noop_regex)) {
+            for (int width: {1, 7, 40}) {
+                for (size_t threads: {0, 1, 3, 100000}) {
+                    ASSERT_EQ(history.render_crt(width, threads), render_crt(program, width));
                 }
             }
         }
+    }
+
+    TEST(Day10, DISABLED_x_history_benchmark) {
+        auto source = generate_program(2000000, 2);
+        auto program = parse_program(source.data(), source.data() + source.size());
+        x_history history(program);
+        auto p_as_float = (double) chrono::steady_clock::period::num / (double) chrono::steady_clock::period::den;
+
+        auto start = chrono::steady_clock::now();
+        auto replayed = signal_strength(program);
+        auto end = chrono::steady_clock::now();
+        cout << "replayed signal strength seconds: " << ((end - start).count() * p_as_float) << endl;
+
+        start = chrono::steady_clock::now();
+        auto last_signal = history.cycle_count() - (history.cycle_count() + 20) % 40;
+        auto indexed = history.weighted_sum(20, 40, last_signal);
+        end = chrono::steady_clock::now();
+        cout << "indexed signal strength seconds: " << ((end - start).count() * p_as_float) << endl;
+        ASSERT_EQ(indexed, replayed);
+
+        for (size_t threads: {1, 4}) {
+            start = chrono::steady_clock::now();
+            auto rows = history.render_crt(1000, threads);
+            end = chrono::steady_clock::now();
+            cout << threads << " thread CRT render seconds: " << ((end - start).count() * p_as_float) << endl;
+        }
+    }
+
+    TEST(Day10, Part1) {
+        mapped_file input("../../test/input/day10.txt");
+
+        cout << signal_strength(parse_program(input.begin(), input.end())) << endl;
+    }
+
+    TEST(Day10, Part2) {
+        mapped_file input("../../test/input/day10.txt");
 
-        for (const auto &item: result) {
+        for (const auto &item: render_crt(parse_program(input.begin(), input.end()))) {
             cout << item << endl;
         }
     }
 
-}
\ No newline at end of file
+}
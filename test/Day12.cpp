@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <fstream>
 #include <unordered_set>
+#include "pos2.h"
 
 using namespace std;
 
@@ -11,47 +12,10 @@ namespace day12 {
         int cost;
     };
 
-    struct pos {
-        int r;
-        int c;
-    };
-
-    ostream &operator<<(ostream &out, const pos &thePos) {
-        out << "{r:" << thePos.r << ", c:" << thePos.c << "}";
-        return out;
-    }
-
-    bool operator<(const pos &a, const pos &b) {
-        return a.r < b.r || (a.r == b.r && a.c < b.c);
-    }
-
-    pos operator+(const pos &a, const pos &b) {
-        return {a.r + b.r, a.c + b.c};
-    }
-
-//template<>
-//struct std::hash<pos> {
-//    std::size_t operator()(const pos& p) const noexcept {
-//        return p.r * 31 + p.c;
-//    }
-//};
-
-    vector<pos> get_adjacent(const pos &p, size_t h, size_t w) {
-        vector<pos> result;
-        if (p.r > 0) {
-            result.push_back(p + pos{-1, 0});
-        }
-        if (p.r < h - 1) {
-            result.push_back(p + pos{1, 0});
-        }
-        if (p.c > 0) {
-            result.push_back(p + pos{0, -1});
-        }
-        if (p.c < w - 1) {
-            result.push_back(p + pos{0, 1});
-        }
-        return result;
-    }
+    /**
+     * x is the column, y is the row
+     */
+    using pos = pos2;
 
     const string sample_input = "Sabqponm\n"
                                 "abcryxxl\n"
@@ -85,10 +49,10 @@ namespace day12 {
                 int height;
                 int cost = numeric_limits<int>::max();
                 if (ch == 'S') {
-                    start = pos{row, i};
+                    start = pos{i, row};
                     height = 0;
                 } else if (ch == 'E') {
-                    target = pos{row, i};
+                    target = pos{i, row};
                     height = 25;
                 } else {
                     height = ch - 'a';
@@ -110,10 +74,9 @@ namespace day12 {
         auto parsed_input = parse_input(input);
         auto &cells = parsed_input.cells;
 
-        cells[parsed_input.start.r][parsed_input.start.c].cost = 0;
+        cells[parsed_input.start.y][parsed_input.start.x].cost = 0;
 
-        size_t w = cells.front().size();
-        size_t h = cells.size();
+        pos2_bounds bounds{{0, 0}, {(int) cells.front().size() - 1, (int) cells.size() - 1}};
         set<pos> frontier{parsed_input.start};
 
         int step_no = 0;
@@ -125,10 +88,9 @@ namespace day12 {
             set<pos> new_frontier;
 
             for (const auto &frnt_pos: frontier) {
-                cell &frnt_cell = cells[frnt_pos.r][frnt_pos.c];
-                const vector<pos> adjacent = get_adjacent(frnt_pos, h, w);
-                for (const auto &adj_pos: adjacent) {
-                    cell &adj_cell = cells.at(adj_pos.r).at(adj_pos.c);
+                cell &frnt_cell = cells[frnt_pos.y][frnt_pos.x];
+                for (const auto &adj_pos: adjacent4.around_within(frnt_pos, bounds)) {
+                    cell &adj_cell = cells.at(adj_pos.y).at(adj_pos.x);
                     if (adj_cell.height - frnt_cell.height <= 1 && step_no < adj_cell.cost) {
                         adj_cell.cost = step_no;
                         new_frontier.insert(adj_pos);
@@ -139,12 +101,11 @@ namespace day12 {
             swap(frontier, new_frontier);
         }
 
-        cout << cells[parsed_input.target.r][parsed_input.target.c].cost << endl;
+        cout << cells[parsed_input.target.y][parsed_input.target.x].cost << endl;
     }
 
     int do_search(vector<vector<cell>> cells, pos target) {
-        size_t w = cells.front().size();
-        size_t h = cells.size();
+        pos2_bounds bounds{{0, 0}, {(int) cells.front().size() - 1, (int) cells.size() - 1}};
         set<pos> frontier{target};
 
         int step_no = 0;
@@ -156,10 +117,9 @@ namespace day12 {
             set<pos> new_frontier;
 
             for (const auto &frnt_pos: frontier) {
-                cell &frnt_cell = cells[frnt_pos.r][frnt_pos.c];
-                const vector<pos> adjacent = get_adjacent(frnt_pos, h, w);
-                for (const auto &adj_pos: adjacent) {
-                    cell &adj_cell = cells.at(adj_pos.r).at(adj_pos.c);
+                cell &frnt_cell = cells[frnt_pos.y][frnt_pos.x];
+                for (const auto &adj_pos: adjacent4.around_within(frnt_pos, bounds)) {
+                    cell &adj_cell = cells.at(adj_pos.y).at(adj_pos.x);
                     if (frnt_cell.height - adj_cell.height <= 1 && step_no < adj_cell.cost) {
                         if (adj_cell.height == 0) {
                             return step_no;
@@ -182,7 +142,7 @@ namespace day12 {
 //    stringstream input(sample_input);
 
         auto parsed_input = parse_input(input);
-        parsed_input.cells[parsed_input.target.r][parsed_input.target.c].cost = 0;
+        parsed_input.cells[parsed_input.target.y][parsed_input.target.x].cost = 0;
 
         int steps = do_search(parsed_input.cells, parsed_input.target);
 
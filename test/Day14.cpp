@@ -1,7 +1,7 @@
 #include <gtest/gtest.h>
 #include <fstream>
 #include <regex>
-#include "position.h"
+#include "pos2.h"
 
 using namespace std;
 
@@ -12,38 +12,32 @@ namespace day14 {
 
     const regex coord_regex("(\\d+),(\\d+)");
 
-    position convert_position(const smatch &results) {
+    pos2 convert_position(const smatch &results) {
         int x = stoi(results[1]);
         int y = stoi(results[2]);
         return {x, y};
     }
 
-    void draw_line(map<position, char> &field, const position &start, const position &end) {
+    void draw_line(grid2<char> &field, const pos2 &start, const pos2 &end) {
         if (start.x == end.x) {
             int miny = min(start.y, end.y);
             int maxy = max(start.y, end.y);
             for (auto y = miny; y <= maxy; ++y) {
-                field[{start.x, y}] = '#';
+                field.set({start.x, y}, '#');
             }
         } else if (start.y == end.y) {
             int minx = min(start.x, end.x);
             int maxx = max(start.x, end.x);
             for (auto x = minx; x <= maxx; ++x) {
-                field[{x, start.y}] = '#';
+                field.set({x, start.y}, '#');
             }
         } else {
             throw logic_error("non-ortho line");
         }
     }
 
-    template<typename K, typename V>
-    V get_or_default(const map<K, V> &map, const K &key, const V &def) {
-        auto iter = map.find(key);
-        return iter == map.end() ? def : iter->second;
-    }
-
-    map<position, char> parse_field(istream &input) {
-        map<position, char> field;
+    grid2<char> parse_field(istream &input) {
+        grid2<char> field('.');
 
         while (true) {
             string line;
@@ -72,52 +66,20 @@ namespace day14 {
         return field;
     }
 
-    pair<position, position> compute_bounds(const map<position, char> &field) {
-        int minx = std::numeric_limits<int>::max();
-        int miny = std::numeric_limits<int>::max();
-        int maxx = std::numeric_limits<int>::min();
-        int maxy = std::numeric_limits<int>::min();
-        for (const auto &item: field) {
-            minx = min(minx, item.first.x);
-            miny = min(miny, item.first.y);
-            maxx = max(maxx, item.first.x);
-            maxy = max(maxy, item.first.y);
-        }
-
-        return {{minx, miny},
-                {maxx, maxy}};
-    }
-
-    void print_field(ostream &out, const map<position, char> &field) {
-        auto bounds = compute_bounds(field);
-        int minx = bounds.first.x;
-        int miny = bounds.first.y;
-        int maxx = bounds.second.x;
-        int maxy = bounds.second.y;
-
-        for (auto y = miny; y <= maxy; ++y) {
-            for (auto x = minx; x <= maxx; ++x) {
-                auto iter = field.find({x, y});
-                out << get_or_default(field, {x, y}, '.');
-            }
-            out << endl;
-        }
-    }
-
 // Returns false if sand goes OOB
-    bool drop_sand(map<position, char> &field, position sand_pos, int oob_y) {
+    bool drop_sand(grid2<char> &field, pos2 sand_pos, int oob_y) {
         while (true) {
-            auto pos_down = sand_pos + position{0, 1};
-            auto pos_dl = sand_pos + position{-1, 1};
-            auto pos_dr = sand_pos + position{1, 1};
-            if (get_or_default(field, pos_down, '.') == '.') {
+            auto pos_down = sand_pos + pos2{0, 1};
+            auto pos_dl = sand_pos + pos2{-1, 1};
+            auto pos_dr = sand_pos + pos2{1, 1};
+            if (field.get(pos_down) == '.') {
                 sand_pos = pos_down;
-            } else if (get_or_default(field, pos_dl, '.') == '.') {
+            } else if (field.get(pos_dl) == '.') {
                 sand_pos = pos_dl;
-            } else if (get_or_default(field, pos_dr, '.') == '.') {
+            } else if (field.get(pos_dr) == '.') {
                 sand_pos = pos_dr;
             } else {
-                field[sand_pos] = 'o';
+                field.set(sand_pos, 'o');
                 return true;
             }
             if (sand_pos.y >= oob_y) {
@@ -127,23 +89,23 @@ namespace day14 {
     }
 
 // Returns the position that the sand comes to a stop
-    position drop_sand2(map<position, char> &field, position sand_pos, int floor_y) {
+    pos2 drop_sand2(grid2<char> &field, pos2 sand_pos, int floor_y) {
         while (true) {
-            auto pos_down = sand_pos + position{0, 1};
-            auto pos_dl = sand_pos + position{-1, 1};
-            auto pos_dr = sand_pos + position{1, 1};
-            if (get_or_default(field, pos_down, '.') == '.') {
+            auto pos_down = sand_pos + pos2{0, 1};
+            auto pos_dl = sand_pos + pos2{-1, 1};
+            auto pos_dr = sand_pos + pos2{1, 1};
+            if (field.get(pos_down) == '.') {
                 sand_pos = pos_down;
-            } else if (get_or_default(field, pos_dl, '.') == '.') {
+            } else if (field.get(pos_dl) == '.') {
                 sand_pos = pos_dl;
-            } else if (get_or_default(field, pos_dr, '.') == '.') {
+            } else if (field.get(pos_dr) == '.') {
                 sand_pos = pos_dr;
             } else {
-                field[sand_pos] = 'o';
+                field.set(sand_pos, 'o');
                 return sand_pos;
             }
             if (sand_pos.y == floor_y - 1) {
-                field[sand_pos] = 'o';
+                field.set(sand_pos, 'o');
                 return sand_pos;
             }
         }
@@ -154,17 +116,15 @@ namespace day14 {
         input.open("../../test/input/day14.txt");
 //    stringstream input(sample_input);
 
-        map<position, char> field = parse_field(input);
+        grid2<char> field = parse_field(input);
 
-        auto bounds = compute_bounds(field);
+        auto bounds = field.bounds();
         int count = 0;
         while (true) {
-            if (!drop_sand(field, position{500, 0}, bounds.second.y + 1)) {
+            if (!drop_sand(field, pos2{500, 0}, bounds.second.y + 1)) {
                 break;
             }
             count++;
-//        print_field(cout, field);
-//        cout << endl;
         }
         cout << count << endl;
     }
@@ -174,17 +134,15 @@ namespace day14 {
         input.open("../../test/input/day14.txt");
 //    stringstream input(sample_input);
 
-        map<position, char> field = parse_field(input);
+        grid2<char> field = parse_field(input);
 
-        const position spout = position{500, 0};
-        auto bounds = compute_bounds(field);
+        const pos2 spout = pos2{500, 0};
+        auto bounds = field.bounds();
         int count = 0;
         while (true) {
             auto rest_pos = drop_sand2(field, spout, bounds.second.y + 2);
             count++;
 //        cout << count << endl;
-//        print_field(cout, field);
-//        cout << endl;
             if (rest_pos == spout) {
                 break;
             }
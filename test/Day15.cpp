@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
+#include <chrono>
 #include <fstream>
 #include <regex>
 #include <set>
+#include "diamond.h"
+#include "diamond_geometry.h"
 #include "position.h"
 #include "span_list.h"
 
@@ -36,6 +39,15 @@ namespace day15 {
         return result;
     }
 
+    vector<diamond> sensor_diamonds(const vector<sb_pair> &sensor_beacon_positions) {
+        vector<diamond> result;
+        for (const auto &item: sensor_beacon_positions) {
+            auto radius = item.sensor_position.manhattan_distance_to(item.beacon_position);
+            result.push_back({item.sensor_position, radius});
+        }
+        return result;
+    }
+
     const string sample_input =
             "Sensor at x=2, y=18: closest beacon is at x=-2, y=15\n"
             "Sensor at x=9, y=16: closest beacon is at x=10, y=16\n"
@@ -52,6 +64,26 @@ namespace day15 {
             "Sensor at x=14, y=3: closest beacon is at x=15, y=3\n"
             "Sensor at x=20, y=1: closest beacon is at x=15, y=3";
 
+    TEST(Day15, diamond_sweep) {
+        stringstream input(sample_input);
+        diamond_sweep sweep(sensor_diamonds(parse(input)));
+
+        EXPECT_EQ(sweep.row_coverage(10).size(), 27);
+        EXPECT_EQ(sweep.find_uncovered({0, 0}, {20, 20}), (position{14, 11}));
+        EXPECT_EQ(sweep.find_uncovered_parallel({0, 0}, {20, 20}, 4), (position{14, 11}));
+        EXPECT_EQ(sweep.find_uncovered({0, 0}, {20, 10}), nullopt);
+    }
+
+    TEST(Day15, diamond_union) {
+        stringstream input(sample_input);
+        diamond_union du(sensor_diamonds(parse(input)));
+
+        EXPECT_TRUE(du.contains({8, 7}));
+        EXPECT_FALSE(du.contains({14, 11}));
+        EXPECT_EQ(du.find_uncovered({0, 0}, {20, 20}), (position{14, 11}));
+        EXPECT_EQ(du.find_uncovered({0, 0}, {20, 10}), nullopt);
+    }
+
     TEST(Day15, Part1) {
         ifstream input;
         input.open("../../test/input/day15.txt");
@@ -61,16 +93,8 @@ namespace day15 {
 
         auto sensor_beacon_positions = parse(input);
 
-        span_list nonbeacon_positions;
-        for (const auto &item: sensor_beacon_positions) {
-            auto radius = item.sensor_position.manhattan_distance_to(item.beacon_position);
-            auto dist_from_row = abs(item.sensor_position.y - magic_row);
-            if (dist_from_row <= radius) {
-                auto minx = item.sensor_position.x - (radius - dist_from_row);
-                auto maxx = minx + (radius - dist_from_row) * 2;
-                nonbeacon_positions.insert_range(minx, maxx);
-            }
-        }
+        diamond_sweep sweep(sensor_diamonds(sensor_beacon_positions));
+        auto nonbeacon_positions = sweep.row_coverage(magic_row);
 
         for (const auto &item: sensor_beacon_positions) {
             if (item.beacon_position.y == magic_row) {
@@ -90,30 +114,57 @@ namespace day15 {
 
         auto sensor_beacon_positions = parse(input);
 
-        vector<span_list> rows(bounds + 1);
-        for (const auto &item: sensor_beacon_positions) {
-            auto radius = item.sensor_position.manhattan_distance_to(item.beacon_position);
-            for (auto r = item.sensor_position.y - radius; r <= item.sensor_position.y + radius; ++r) {
-                if (r < 0 || r > bounds) {
-                    continue;
-                }
-                auto radius_this_row = radius - abs(item.sensor_position.y - r);
-                if (radius_this_row >= 0) {
-                    auto minx = min(bounds, max(0, item.sensor_position.x - radius_this_row));
-                    auto maxx = min(bounds, max(0, item.sensor_position.x + radius_this_row));
-                    rows.at(r).insert_range(minx, maxx);
-                }
-            }
+        diamond_sweep sweep(sensor_diamonds(sensor_beacon_positions));
+        auto found = sweep.find_uncovered_parallel({0, 0}, {bounds, bounds}, thread::hardware_concurrency());
+        if (!found) {
+            throw logic_error("no uncovered position");
         }
 
-        for (long long r = 0; r < rows.size(); ++r) {
-            auto &row = rows[r];
-            if (row.end() - row.begin() > 1) {
-                long long c = row.begin()->last() + 1;
-                cout << (c * 4000000 + r) << endl;
-                break;
-            }
+        cout << (found->x * 4000000LL + found->y) << endl;
+    }
+
+    TEST(Day15, Part2_rotated) {
+        ifstream input;
+        input.open("../../test/input/day15.txt");
+        int bounds = 4000000;
+//    stringstream input(sample_input);
+//    int bounds = 20;
+
+        diamond_union du(sensor_diamonds(parse(input)));
+        auto found = du.find_uncovered({0, 0}, {bounds, bounds});
+        if (!found) {
+            throw logic_error("no uncovered position");
+        }
+
+        cout << (found->x * 4000000LL + found->y) << endl;
+    }
+
+    TEST(Day15, DISABLED_Part2_benchmark) {
+        ifstream input;
+        input.open("../../test/input/day15.txt");
+        int bounds = 4000000;
+        const int iterations = 20;
+
+        auto diamonds = sensor_diamonds(parse(input));
+        auto p_as_float = (double) chrono::steady_clock::period::num / (double) chrono::steady_clock::period::den;
+
+        auto start = chrono::steady_clock::now();
+        optional<position> by_rows;
+        for (int i = 0; i < iterations; ++i) {
+            by_rows = diamond_sweep(diamonds).find_uncovered({0, 0}, {bounds, bounds});
         }
+        auto end = chrono::steady_clock::now();
+        cout << "row sweep seconds per run: " << ((end - start).count() * p_as_float / iterations) << endl;
+
+        start = chrono::steady_clock::now();
+        optional<position> rotated;
+        for (int i = 0; i < iterations; ++i) {
+            rotated = diamond_union(diamonds).find_uncovered({0, 0}, {bounds, bounds});
+        }
+        end = chrono::steady_clock::now();
+        cout << "rotated seconds per run: " << ((end - start).count() * p_as_float / iterations) << endl;
+
+        EXPECT_EQ(by_rows, rotated);
     }
 
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
+#include <chrono>
 #include <fstream>
 #include <regex>
+#include "morton.h"
 #include "pos3.h"
 #include "util.h"
 
@@ -41,22 +43,58 @@ namespace day18 {
         return positions;
     }
 
+    TEST(Day18, adjacent) {
+        static_assert(pos3_adjacent({0, 0, 0}).size() == 6);
+        static_assert(adjacent26.around({0, 0, 0})[25] == pos3{1, 1, 1});
+
+        auto adj = pos3_adjacent({1, 2, 3});
+        auto distinct = make_pos3_ordered_set();
+        distinct.insert(adj.begin(), adj.end());
+        EXPECT_EQ(distinct.size(), 6);
+        EXPECT_FALSE(set_contains(distinct, pos3{1, 2, 3}));
+
+        struct pos3_bounds bounds{{0, 0, 0}, {4, 4, 4}};
+        EXPECT_EQ(adjacent6.around_within({0, 0, 0}, bounds).size(), 3);
+        EXPECT_EQ(adjacent26.around_within({0, 0, 0}, bounds).size(), 7);
+        EXPECT_EQ(adjacent26.around_within({2, 2, 2}, bounds).size(), 26);
+    }
+
+    voxel_grid make_voxel_grid(const pos3_ordered_set &positions) {
+        voxel_grid result(pos3_bounds(positions.begin(), positions.end()));
+        for (const auto &p: positions) {
+            result.set(p);
+        }
+        return result;
+    }
+
+    TEST(Day18, voxel_grid) {
+        stringstream input(sample_input);
+        auto cubes = make_voxel_grid(parse_positions(input));
+        EXPECT_EQ(cubes.count(), 13);
+        EXPECT_EQ(6 * cubes.count() - cubes.count_faces_against(cubes), 64);
+
+        // rows wider than one word
+        auto bar_cells = make_pos3_ordered_set();
+        for (int x = -30; x < 100; ++x) {
+            bar_cells.insert({x, 5, 5});
+        }
+        auto bar = make_voxel_grid(bar_cells);
+        EXPECT_EQ(6 * bar.count() - bar.count_faces_against(bar), 4 * 130 + 2);
+        EXPECT_TRUE(bar.shifted({1, 0, 0}).test({100, 5, 5}));
+        EXPECT_FALSE(bar.shifted({1, 0, 0}).test({-30, 5, 5}));
+        EXPECT_TRUE(bar.shifted({-1, 0, 0}).test({-31, 5, 5}));
+        EXPECT_TRUE(bar.shifted({0, 0, 1}).test({33, 5, 6}));
+        EXPECT_EQ(bar.dilated().count(), 130 * 5 + 2);
+    }
+
     TEST(Day18, Part1) {
         ifstream input;
         input.open("../../test/input/day18.txt");
 //    stringstream input(sample_input);
 
-        auto positions = parse_positions(input);
+        auto cubes = make_voxel_grid(parse_positions(input));
 
-        auto sides = 0;
-        for (const auto &pos: positions) {
-            sides += 6;
-            for (const auto &adj: pos3_adjacent(pos)) {
-                if (positions.find(adj) != positions.end()) {
-                    sides -= 1;
-                }
-            }
-        }
+        auto sides = 6 * cubes.count() - cubes.count_faces_against(cubes);
 
         cout << sides << endl;
     }
@@ -66,47 +104,77 @@ namespace day18 {
         input.open("../../test/input/day18.txt");
 //    stringstream input(sample_input);
 
-        auto positions = parse_positions(input);
-
-        auto bounds = pos3_bounds(positions.begin(), positions.end());
-        bounds.min.x -= 1;
-        bounds.min.y -= 1;
-        bounds.min.z -= 1;
-        bounds.max.x += 1;
-        bounds.max.y += 1;
-        bounds.max.z += 1;
-        auto start_pos = bounds.min;
-
-        auto seen = make_pos3_ordered_set();
-        auto frontier = make_pos3_ordered_set();
+        auto cubes = make_voxel_grid(parse_positions(input));
+        auto air = ~cubes;
+
+        // the border around the cubes is all outside air, so flood inwards from there
+        voxel_grid outside(cubes.bounds());
+        outside.set_border();
+        while (true) {
+            auto next = outside.dilated();
+            next &= air;
+            if (next == outside) {
+                break;
+            }
+            outside = std::move(next);
+        }
 
-        frontier.insert(start_pos);
+        auto surfaces = cubes.count_faces_against(outside);
 
-        while (!frontier.empty()) {
-            auto f = *frontier.begin();
-            frontier.erase(frontier.begin());
+        cout << surfaces << endl;
+    }
 
-            auto [_, inserted] = seen.insert(f);
-            if (inserted) {
-                for (const auto &adj: pos3_adjacent(f)) {
-                    if (bounds.contains(adj) && !set_contains(positions, adj)) {
-                        frontier.insert(adj);
-                    }
+    template <typename Set>
+    int count_exposed_sides(const Set &cubes) {
+        auto sides = 0;
+        for (const auto &pos: cubes) {
+            for (const auto &adj: pos3_adjacent(pos)) {
+                if (!cubes.contains(adj)) {
+                    ++sides;
                 }
             }
         }
+        return sides;
+    }
+
+    struct ordered_set_adapter {
+        pos3_ordered_set positions;
+
+        [[nodiscard]] auto begin() const { return positions.begin(); }
+
+        [[nodiscard]] auto end() const { return positions.end(); }
 
-        auto surfaces = 0;
-        for (const auto &air: seen) {
-            auto adj = pos3_adjacent(air);
-            for (const auto &a: pos3_adjacent(air)) {
-                if (set_contains(positions, a)) {
-                    ++surfaces;
+        [[nodiscard]] bool contains(const pos3 &p) const { return set_contains(positions, p); }
+    };
+
+    TEST(Day18, DISABLED_neighbor_lookup_benchmark) {
+        // a lumpy ball: every cell within radius 25 of the center, minus a few holes
+        vector<pos3> cubes;
+        for (int z = -25; z <= 25; ++z) {
+            for (int y = -25; y <= 25; ++y) {
+                for (int x = -25; x <= 25; ++x) {
+                    if (x * x + y * y + z * z <= 625 && (x * 7 + y * 13 + z * 3) % 17 != 0) {
+                        cubes.push_back({x, y, z});
+                    }
                 }
             }
         }
-
-        cout << surfaces << endl;
+        auto p_as_float = (double) chrono::steady_clock::period::num / (double) chrono::steady_clock::period::den;
+
+        auto start = chrono::steady_clock::now();
+        ordered_set_adapter ordered{make_pos3_ordered_set()};
+        ordered.positions.insert(cubes.begin(), cubes.end());
+        auto ordered_sides = count_exposed_sides(ordered);
+        auto end = chrono::steady_clock::now();
+        cout << "pos3_ordered_set seconds: " << ((end - start).count() * p_as_float) << endl;
+
+        start = chrono::steady_clock::now();
+        morton_set<pos3> morton(cubes.begin(), cubes.end());
+        auto morton_sides = count_exposed_sides(morton);
+        end = chrono::steady_clock::now();
+        cout << "morton_set seconds: " << ((end - start).count() * p_as_float) << endl;
+
+        EXPECT_EQ(ordered_sides, morton_sides);
     }
 
 }
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
-#include <fstream>
+#include <array>
+#include <cstdint>
+#include <random>
+#include "mapped_file.h"
+#include "simd.h"
 
 namespace day2 {
 
@@ -44,27 +48,193 @@ namespace day2 {
         }
     }
 
-    int move_score(move m) {
+    constexpr int move_score(move m) {
         return m + 1;
     }
 
-    outcome match_outcome(move opp_move, move my_move) {
+    constexpr outcome match_outcome(move opp_move, move my_move) {
         return outcome((my_move - opp_move + 4) % 3);
     }
 
-    move find_move(move opp_move, outcome desired_outcome) {
+    constexpr move find_move(move opp_move, outcome desired_outcome) {
         return move(((desired_outcome + 2) + opp_move) % 3);
     }
 
-    int win_score(move opp_move, move my_move) {
+    constexpr int win_score(move opp_move, move my_move) {
         auto result = match_outcome(opp_move, my_move);
         return result * 3;
     }
 
-    int total_score(move opp_move, move my_move) {
+    constexpr int total_score(move opp_move, move my_move) {
         return move_score(my_move) + win_score(opp_move, my_move);
     }
 
+    /**
+     * Score of each round for both parts, indexed by (opponent - 'A') * 3 + (second column - 'X').
+     */
+    constexpr std::array<uint8_t, 16> make_score_table(bool second_column_is_outcome) {
+        std::array<uint8_t, 16> table{};
+        for (int opp = 0; opp < 3; ++opp) {
+            for (int second = 0; second < 3; ++second) {
+                auto my_move = second_column_is_outcome ? find_move(move(opp), outcome(second)) : move(second);
+                table[opp * 3 + second] = total_score(move(opp), my_move);
+            }
+        }
+        return table;
+    }
+
+    constexpr auto part1_scores = make_score_table(false);
+    constexpr auto part2_scores = make_score_table(true);
+
+    struct scores {
+        long part1;
+        long part2;
+    };
+
+    // Each round is the 4 bytes "A X\n"; subtracting this word from one leaves {opp, 0, second, 0}
+    constexpr uint32_t round_base = 'A' | ' ' << 8 | 'X' << 16 | '\n' << 24;
+
+    /**
+     * Scores rounds one line at a time starting at p, stopping once it has skipped a blank line or reached end.
+     * Returns where it stopped. Lines may end in "\r\n", and the last one may leave off the newline.
+     */
+    const char *score_lines(const char *p, const char *end, scores &result) {
+        while (p < end) {
+            if (*p == '\n' || (*p == '\r' && end - p >= 2 && p[1] == '\n')) {
+                return p + (*p == '\r' ? 2 : 1);
+            }
+            if (end - p < 3 || p[1] != ' ' || p[0] < 'A' || p[0] > 'C' || p[2] < 'X' || p[2] > 'Z') {
+                throw std::logic_error("invalid");
+            }
+            unsigned index = (p[0] - 'A') * 3 + (p[2] - 'X');
+            result.part1 += part1_scores[index];
+            result.part2 += part2_scores[index];
+            p += 3;
+            if (p < end && *p == '\r') {
+                ++p;
+            }
+            if (p < end) {
+                if (*p != '\n') {
+                    throw std::logic_error("invalid");
+                }
+                ++p;
+            }
+        }
+        return p;
+    }
+
+#ifdef SIMD_X86
+    /**
+     * Scores 8 rounds at a time from p for as long as every round in the next 32 bytes is exactly "A X\n", and
+     * returns where it stopped. Each 4-byte round becomes a table index, and the scores are looked up with a
+     * byte shuffle.
+     */
+    __attribute__((target("avx2")))
+    const char *score_blocks_avx2(const char *p, const char *end, scores &result) {
+        const auto base = _mm256_set1_epi32((int) round_base);
+        const auto max_digit = _mm256_set1_epi32(0x00020002);
+        const auto index_high_bytes = _mm256_set1_epi32((int) 0xffffff00);
+        const auto low_byte = _mm256_set1_epi32(0xff);
+        const auto table1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) part1_scores.data()));
+        const auto table2 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) part2_scores.data()));
+        bool stopped = false;
+        while (!stopped && end - p >= 32) {
+            // Lane sums are at most 9 per step, so flush them well before they could overflow
+            auto sum1 = _mm256_setzero_si256();
+            auto sum2 = _mm256_setzero_si256();
+            for (int i = 0; i < (1 << 20) && end - p >= 32; ++i, p += 32) {
+                auto fields = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i *) p), base);
+                auto bad = _mm256_xor_si256(_mm256_max_epu8(fields, max_digit), max_digit);
+                if (!_mm256_testz_si256(bad, bad)) {
+                    stopped = true;
+                    break;
+                }
+                auto opp = _mm256_and_si256(fields, low_byte);
+                auto second = _mm256_srli_epi32(fields, 16);
+                auto index = _mm256_or_si256(_mm256_add_epi32(_mm256_add_epi32(opp, opp),
+                                                              _mm256_add_epi32(opp, second)), index_high_bytes);
+                sum1 = _mm256_add_epi32(sum1, _mm256_shuffle_epi8(table1, index));
+                sum2 = _mm256_add_epi32(sum2, _mm256_shuffle_epi8(table2, index));
+            }
+            int lanes1[8];
+            int lanes2[8];
+            _mm256_storeu_si256((__m256i *) lanes1, sum1);
+            _mm256_storeu_si256((__m256i *) lanes2, sum2);
+            for (int l = 0; l < 8; ++l) {
+                result.part1 += lanes1[l];
+                result.part2 += lanes2[l];
+            }
+        }
+        return p;
+    }
+
+    /**
+     * score_blocks_avx2, 4 rounds at a time.
+     */
+    __attribute__((target("ssse3")))
+    const char *score_blocks_ssse3(const char *p, const char *end, scores &result) {
+        const auto base = _mm_set1_epi32((int) round_base);
+        const auto max_digit = _mm_set1_epi32(0x00020002);
+        const auto index_high_bytes = _mm_set1_epi32((int) 0xffffff00);
+        const auto low_byte = _mm_set1_epi32(0xff);
+        const auto table1 = _mm_loadu_si128((const __m128i *) part1_scores.data());
+        const auto table2 = _mm_loadu_si128((const __m128i *) part2_scores.data());
+        bool stopped = false;
+        while (!stopped && end - p >= 16) {
+            auto sum1 = _mm_setzero_si128();
+            auto sum2 = _mm_setzero_si128();
+            for (int i = 0; i < (1 << 20) && end - p >= 16; ++i, p += 16) {
+                auto fields = _mm_sub_epi8(_mm_loadu_si128((const __m128i *) p), base);
+                auto bad = _mm_xor_si128(_mm_max_epu8(fields, max_digit), max_digit);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128())) != 0xffff) {
+                    stopped = true;
+                    break;
+                }
+                auto opp = _mm_and_si128(fields, low_byte);
+                auto second = _mm_srli_epi32(fields, 16);
+                auto index = _mm_or_si128(_mm_add_epi32(_mm_add_epi32(opp, opp), _mm_add_epi32(opp, second)),
+                                          index_high_bytes);
+                sum1 = _mm_add_epi32(sum1, _mm_shuffle_epi8(table1, index));
+                sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi8(table2, index));
+            }
+            int lanes1[4];
+            int lanes2[4];
+            _mm_storeu_si128((__m128i *) lanes1, sum1);
+            _mm_storeu_si128((__m128i *) lanes2, sum2);
+            for (int l = 0; l < 4; ++l) {
+                result.part1 += lanes1[l];
+                result.part2 += lanes2[l];
+            }
+        }
+        return p;
+    }
+#endif
+
+    /**
+     * Scores every round in [begin, end) for both parts in one pass. Blank lines are skipped. Runs of rounds
+     * that are exactly "A X\n" go through the chosen SIMD kernel, which treats the buffer as an array of 4-byte
+     * words; anything else (blank lines, "\r\n", the tail) is handled a line at a time. The shuffle needs SSSE3,
+     * so with only SSE2 everything goes a line at a time.
+     */
+    scores score_rounds(const char *begin, const char *end, simd_kernel kernel = best_kernel()) {
+        if (!kernel_supported(kernel)) {
+            throw std::logic_error("unsupported kernel");
+        }
+        scores result{0, 0};
+        const char *p = begin;
+        while (p < end) {
+#ifdef SIMD_X86
+            if (kernel == simd_kernel::avx2) {
+                p = score_blocks_avx2(p, end, result);
+            } else if (kernel == simd_kernel::ssse3) {
+                p = score_blocks_ssse3(p, end, result);
+            }
+#endif
+            p = score_lines(p, end, result);
+        }
+        return result;
+    }
+
     TEST(Day2, win_score) {
         ASSERT_EQ(win_score(rock, rock), 3);
         ASSERT_EQ(win_score(rock, paper), 6);
@@ -101,43 +271,79 @@ namespace day2 {
         ASSERT_EQ(find_move(scissors, win), rock);
     }
 
-    TEST(Day2, Part1) {
-        std::ifstream input;
-        input.open("../../test/input/day2.txt");
-        long sum = 0;
-        while (input) {
-            char opponent_move;
-            char my_move;
-            input >> opponent_move >> my_move;
-            if (!input) {
-                break;
+    TEST(Day2, score_rounds) {
+        std::string sample = "A Y\nB X\nC Z\n";
+        auto result = score_rounds(sample.data(), sample.data() + sample.size());
+        ASSERT_EQ(result.part1, 15);
+        ASSERT_EQ(result.part2, 12);
+
+        result = score_rounds(sample.data(), sample.data() + sample.size() - 1);
+        ASSERT_EQ(result.part1, 15);
+        ASSERT_EQ(result.part2, 12);
+
+        std::mt19937 random(1);
+        for (int length: {0, 1, 7, 8, 9, 31, 32, 33, 100, 1000}) {
+            std::string input;
+            long part1 = 0;
+            long part2 = 0;
+            for (int i = 0; i < length; ++i) {
+                char opp = char('A' + random() % 3);
+                char second = char('X' + random() % 3);
+                input += {opp, ' ', second, '\n'};
+                part1 += total_score(to_move(opp), to_move(second));
+                part2 += total_score(to_move(opp), find_move(to_move(opp), to_outcome(second)));
+            }
+            result = score_rounds(input.data(), input.data() + input.size());
+            ASSERT_EQ(result.part1, part1);
+            ASSERT_EQ(result.part2, part2);
+
+            if (length > 0) {
+                auto bad = input;
+                bad[(random() % length) * 4 + random() % 3] = 'D';
+                ASSERT_THROW(score_rounds(bad.data(), bad.data() + bad.size()), std::logic_error);
             }
-            auto incremental_score = total_score(to_move(opponent_move), to_move(my_move));
-            std::cout << opponent_move << "  " << my_move << "  " << incremental_score << "\n";
-            sum += incremental_score;
         }
 
-        std::cout << sum << "\n";
+        std::string blank_lines = "\nA Y\n\nB X\r\n\r\nC Z\n\n";
+        result = score_rounds(blank_lines.data(), blank_lines.data() + blank_lines.size());
+        ASSERT_EQ(result.part1, 15);
+        ASSERT_EQ(result.part2, 12);
     }
 
-    TEST(Day2, Part2) {
-        std::ifstream input;
-        input.open("../../test/input/day2.txt");
-        std::string line;
-        auto sum = 0;
-        std::vector<int> counts;
-        while (input) {
-            char opponent_move;
-            char outcome;
-            input >> opponent_move >> outcome;
-            if (!input) {
-                break;
+    TEST(Day2, score_rounds_kernels) {
+        std::mt19937 random(2);
+        for (int length: {0, 1, 3, 4, 5, 8, 9, 31, 32, 33, 100, 1000}) {
+            std::string input;
+            for (int i = 0; i < length; ++i) {
+                input += {char('A' + random() % 3), ' ', char('X' + random() % 3), '\n'};
+                // now and then a blank line, which puts the rest of the rounds off the 4-byte grid
+                if (random() % 50 == 0) {
+                    input += '\n';
+                }
+            }
+            auto expected = score_rounds(input.data(), input.data() + input.size(), simd_kernel::scalar);
+            for (auto kernel: supported_kernels()) {
+                auto result = score_rounds(input.data(), input.data() + input.size(), kernel);
+                ASSERT_EQ(result.part1, expected.part1);
+                ASSERT_EQ(result.part2, expected.part2);
+
+                if (length > 0) {
+                    auto bad = input;
+                    bad[random() % bad.size()] = 'D';
+                    ASSERT_THROW(score_rounds(bad.data(), bad.data() + bad.size(), kernel), std::logic_error);
+                }
             }
-            auto my_move = find_move(to_move(opponent_move), to_outcome(outcome));
-            sum += total_score(to_move(opponent_move), my_move);
         }
+    }
 
-        std::cout << sum << "\n";
+    TEST(Day2, Part1) {
+        mapped_file input("../../test/input/day2.txt");
+        std::cout << score_rounds(input.begin(), input.end()).part1 << "\n";
+    }
+
+    TEST(Day2, Part2) {
+        mapped_file input("../../test/input/day2.txt");
+        std::cout << score_rounds(input.begin(), input.end()).part2 << "\n";
     }
 
-}
\ No newline at end of file
+}
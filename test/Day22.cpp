@@ -24,29 +24,21 @@ namespace day22 {
 
     const regex directions_regex("(?:(\\d+)|([RL]))");
 
-    char get_map(const vector<string> &map, pos2 pos) {
-        if (pos.y < 0 || pos.y >= map.size()) {
-            return ' ';
-        }
-        const auto &line = map[pos.y];
-        if (pos.x < 0 || pos.x >= line.size()) {
-            return ' ';
-        }
-        return line[pos.x];
-    }
-
-    pair<pos2, char> find_adjacent(const vector<string> &map, pos2 pos, pos2 dir) {
+    /**
+     * Off-map cells read as ' '. Since every move starts on the map, pos + dir never goes past the padding.
+     */
+    pair<pos2, char> find_adjacent(const grid2<char> &map, pos2 pos, pos2 dir) {
         pos2 new_pos = pos + dir;
-        char ch = get_map(map, new_pos);
+        char ch = map[new_pos];
         if (ch != ' ') {
             return {new_pos, ch};
         } else {
             auto scanpos = pos - dir;
-            while (get_map(map, scanpos) != ' ') {
+            while (map[scanpos] != ' ') {
                 scanpos -= dir;
             }
             scanpos += dir;
-            return {scanpos, get_map(map, scanpos)};
+            return {scanpos, map[scanpos]};
         }
     }
 
@@ -67,19 +59,23 @@ namespace day22 {
         input.open("../../test/input/day22.txt");
 //        stringstream input(sample_input);
 
-        vector<string> map;
+        grid2<char> map(' ');
         string line;
-        while (getline(input, line)) {
+        for (int y = 0; getline(input, line); ++y) {
             if (line.empty()) {
                 break;
             }
-            map.push_back(line);
+            for (int x = 0; x < line.length(); ++x) {
+                if (line[x] != ' ') {
+                    map.set({x, y}, line[x]);
+                }
+            }
         }
         string directions_line;
         getline(input, directions_line);
 
-        auto iter = std::find_if(map[0].cbegin(), map[0].cend(), [](auto ch) { return ch != ' '; });
-        pos2 my_pos{(int) (iter - map[0].begin()), 0};
+        auto iter = std::find_if(map.row_begin(0), map.row_end(0), [](auto ch) { return ch != ' '; });
+        pos2 my_pos{(int) (iter - map.row_begin(0)) + map.bounds().first.x, 0};
         pos2 my_dir{1, 0};
 
         smatch mr;
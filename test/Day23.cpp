@@ -1,9 +1,11 @@
 #include <gtest/gtest.h>
 #include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <regex>
 #include <set>
 #include <unordered_set>
+#include "morton.h"
 #include "pos2.h"
 #include "util.h"
 
@@ -31,101 +33,99 @@ namespace day22 {
                                 "..............\n"
                                 "..............\n";
 
-    const vector<vector<pos2>> offsets_to_check{
+    constexpr array<stencil<pos2, 3>, 4> offsets_to_check{{
             //NORTH
-            {
-                    {-1, -1},
-                    {0,  -1},
-                    {1,  -1}},
+            {{{{-1, -1}, {0, -1}, {1, -1}}}},
             //SOUTH
-            {
-                    {-1, 1},
-                    {0,  1},
-                    {1,  1}},
+            {{{{-1, 1}, {0, 1}, {1, 1}}}},
             //WEST
-            {
-                    {-1, -1},
-                    {-1, 0},
-                    {-1, 1}},
+            {{{{-1, -1}, {-1, 0}, {-1, 1}}}},
             //EAST
-            {
-                    {1,  -1},
-                    {1,  0},
-                    {1,  1}}
-    };
-
-    const vector<pos2> all_adjacent{
-            {-1, -1},
-            {-1, 0},
-            {-1, 1},
-            {0,  -1},
-            {0,  1},
-            {1,  -1},
-            {1,  0},
-            {1,  1}
-    };
-
-    set<pos2> step_elves(const set<pos2> &elves, int offset_offset) {
-        //dest, srcs
-        map<pos2, vector<pos2>> proposed_moves;
-        set < pos2 > new_elves;
-        for (const auto &elf: elves) {
-            int i;
-            for (i = 0; i < 4; ++i) {
-                int offset = (i + offset_offset) % 4;
-                const auto &to_check = offsets_to_check[offset];
-                auto dir_open = all_of(
-                        to_check.begin(),
-                        to_check.end(),
-                        [&](const auto &elem) {
-                            return !set_contains(elves, elf + elem);
-                        });
+            {{{{1, -1}, {1, 0}, {1, 1}}}}
+    }};
+
+    /**
+     * Moves every elf one round. Returns false if no elf moved.
+     */
+    bool step_elves(grid2<char> &elves, int offset_offset) {
+        auto [emin, emax] = elves.bounds();
+        pos2 grown_min = emin - pos2{1, 1};
+        pos2 grown_max = emax + pos2{1, 1};
+
+        //src, dest
+        vector<pair<pos2, pos2>> proposed_moves;
+        grid2<int> proposal_counts(0);
+        proposal_counts.reserve(grown_min, grown_max);
+        vector<pos2> staying;
+
+        for (auto y = emin.y; y <= emax.y; ++y) {
+            for (auto x = emin.x; x <= emax.x; ++x) {
+                pos2 elf{x, y};
+                if (elves[elf] != '#') {
+                    continue;
+                }
+                auto neighbors = adjacent8.around(elf);
                 auto has_friends = any_of(
-                        all_adjacent.begin(), all_adjacent.end(),
-                        [&](const auto &elem) {
-                            return set_contains(elves, elf + elem);
+                        neighbors.begin(), neighbors.end(),
+                        [&](const auto &p) {
+                            return elves[p] == '#';
                         });
-                if (has_friends && dir_open) {
-                    auto dest = elf + to_check[1];
-                    proposed_moves[dest].push_back(elf);
-                    break;
+                int i = 4;
+                if (has_friends) {
+                    for (i = 0; i < 4; ++i) {
+                        int offset = (i + offset_offset) % 4;
+                        auto to_check = offsets_to_check[offset].around(elf);
+                        auto dir_open = all_of(
+                                to_check.begin(),
+                                to_check.end(),
+                                [&](const auto &p) {
+                                    return elves[p] != '#';
+                                });
+                        if (dir_open) {
+                            auto dest = to_check[1];
+                            proposed_moves.emplace_back(elf, dest);
+                            proposal_counts[dest]++;
+                            break;
+                        }
+                    }
+                }
+                if (i == 4) {
+                    staying.push_back(elf);
                 }
-            }
-            if (i == 4) {
-                new_elves.insert(elf);
             }
         }
 
-        for (const auto &[dst, srcs]: proposed_moves) {
-            if (srcs.size() == 1) {
-                new_elves.insert(dst);
+        grid2<char> new_elves('.');
+        new_elves.reserve(grown_min, grown_max);
+        for (const auto &elf: staying) {
+            new_elves.set(elf, '#');
+        }
+        bool moved = false;
+        for (const auto &[src, dst]: proposed_moves) {
+            if (proposal_counts[dst] == 1) {
+                new_elves.set(dst, '#');
+                moved = true;
             } else {
-                new_elves.insert(srcs.begin(), srcs.end());
+                new_elves.set(src, '#');
             }
         }
 
-        return new_elves;
+        elves = std::move(new_elves);
+        return moved;
     }
 
-    string format_elves(const set<pos2> &elves) {
+    string format_elves(const grid2<char> &elves) {
         stringstream result;
-        auto [min, max] = bounding_box(elves);
+        auto [min, max] = elves.bounds();
         for (auto y = min.y; y <= max.y; ++y) {
-            for (auto x = min.x; x <= max.x; ++x) {
-                if (set_contains(elves, {x, y})) {
-                    result << '#';
-                } else {
-                    result << '.';
-                }
-            }
-            result << '\n';
+            result << string(elves.row_begin(y), elves.row_end(y)) << '\n';
         }
         return result.str();
     }
 
-    set<pos2> read_elves(istream &input) {
+    grid2<char> read_elves(istream &input) {
         string line;
-        set < pos2 > elves;
+        grid2<char> elves('.');
         int line_no = 0;
         while (getline(input, line)) {
             if (line.empty()) {
@@ -133,7 +133,7 @@ namespace day22 {
             }
             for (auto char_no = 0; char_no < line.length(); ++char_no) {
                 if (line[char_no] == '#') {
-                    elves.insert({char_no, line_no});
+                    elves.set({char_no, line_no}, '#');
                 }
             }
             ++line_no;
@@ -153,21 +153,16 @@ namespace day22 {
 //        cout << std::endl;
 
         for (int i = 0; i < 10; ++i) {
-            auto new_elves = step_elves(elves, i);
-//            cout << format_elves(new_elves);
+            step_elves(elves, i);
+//            cout << format_elves(elves);
 //            cout << std::endl;
 //            cout << std::endl;
-            elves = std::move(new_elves);
         }
 
-        auto [emin, emax] = bounding_box(elves);
+        auto [emin, emax] = elves.bounds();
         auto empty_ground = 0;
         for (auto y = emin.y; y <= emax.y; ++y) {
-            for (auto x = emin.x; x <= emax.x; ++x) {
-                if (!set_contains(elves, {x, y})) {
-                    empty_ground++;
-                }
-            }
+            empty_ground += count(elves.row_begin(y), elves.row_end(y), '.');
         }
 
         cout << empty_ground << endl;
@@ -182,14 +177,59 @@ namespace day22 {
 
         int i;
         for (i = 0; ; ++i) {
-            auto new_elves = step_elves(elves, i);
-            if (new_elves == elves) {
+            if (!step_elves(elves, i)) {
                 break;
             }
-            elves = std::move(new_elves);
         }
 
         cout << (i + 1) << endl;
     }
 
+    TEST(Day23, DISABLED_neighbor_lookup_benchmark) {
+        ifstream input;
+        input.open("../../test/input/day23.txt");
+
+        auto elves = read_elves(input);
+        vector<pos2> positions;
+        auto [emin, emax] = elves.bounds();
+        for (auto y = emin.y; y <= emax.y; ++y) {
+            for (auto x = emin.x; x <= emax.x; ++x) {
+                if (elves[{x, y}] == '#') {
+                    positions.push_back({x, y});
+                }
+            }
+        }
+        const int iterations = 50;
+        auto p_as_float = (double) chrono::steady_clock::period::num / (double) chrono::steady_clock::period::den;
+
+        auto count_crowded = [&](const auto &contains) {
+            int crowded = 0;
+            for (const auto &elf: positions) {
+                auto neighbors = adjacent8.around(elf);
+                crowded += any_of(neighbors.begin(), neighbors.end(), contains);
+            }
+            return crowded;
+        };
+
+        set<pos2> ordered(positions.begin(), positions.end());
+        auto start = chrono::steady_clock::now();
+        int ordered_crowded = 0;
+        for (int i = 0; i < iterations; ++i) {
+            ordered_crowded = count_crowded([&](const pos2 &p) { return set_contains(ordered, p); });
+        }
+        auto end = chrono::steady_clock::now();
+        cout << "set<pos2> seconds: " << ((end - start).count() * p_as_float) << endl;
+
+        morton_set<pos2> morton(positions.begin(), positions.end());
+        start = chrono::steady_clock::now();
+        int morton_crowded = 0;
+        for (int i = 0; i < iterations; ++i) {
+            morton_crowded = count_crowded([&](const pos2 &p) { return morton.contains(p); });
+        }
+        end = chrono::steady_clock::now();
+        cout << "morton_set<pos2> seconds: " << ((end - start).count() * p_as_float) << endl;
+
+        EXPECT_EQ(ordered_crowded, morton_crowded);
+    }
+
 }
\ No newline at end of file
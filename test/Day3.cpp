@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
-#include <fstream>
-#include <unordered_set>
+#include <set>
+#include <sstream>
+#include "mapped_file.h"
+#include "scan.h"
 
 namespace day3 {
 
@@ -15,73 +17,135 @@ namespace day3 {
         }
     }
 
+    struct priority_sums {
+        int part1;
+        int part2;
 
-    TEST(Day3, Part1) {
-        std::ifstream input;
-        input.open("../../test/input/day3.txt");
-        auto sum = 0;
-        while (true) {
-            std::string line;
-            std::getline(input, line);
-            if (!input) {
-                break;
+        bool operator==(const priority_sums &b) const { return part1 == b.part1 && part2 == b.part2; }
+    };
+
+    /**
+     * Set of items with bit item_priority(item) set for each one, so intersecting is an AND and the priority of
+     * a single common item is its bit index.
+     */
+    uint64_t item_mask(const char *begin, const char *end) {
+        uint64_t mask = 0;
+        for (auto p = begin; p < end; ++p) {
+            mask |= 1ull << item_priority(*p);
+        }
+        return mask;
+    }
+
+    int mask_priority(uint64_t mask) {
+        if (mask == 0) {
+            throw std::logic_error("impossible");
+        }
+        return __builtin_ctzll(mask);
+    }
+
+    /**
+     * Both parts in a single pass over the buffer: each line is split into two compartment masks for part 1,
+     * and their union is ANDed into the running group mask for part 2.
+     */
+    priority_sums sum_priorities(const char *begin, const char *end) {
+        priority_sums sums{0, 0};
+        const int groupSize = 3;
+        int group_count = 0;
+        uint64_t group_mask = ~0ull;
+        for_each_line(begin, end, [&](const char *line_begin, const char *line_end) {
+            if (line_end > line_begin && line_end[-1] == '\r') {
+                --line_end;
+            }
+            if (line_begin == line_end) {
+                return;
+            }
+            auto middle = line_begin + (line_end - line_begin) / 2;
+            auto compartment1 = item_mask(line_begin, middle);
+            auto compartment2 = item_mask(middle, line_end);
+            sums.part1 += mask_priority(compartment1 & compartment2);
+
+            group_mask &= compartment1 | compartment2;
+            if (++group_count == groupSize) {
+                sums.part2 += mask_priority(group_mask);
+                group_count = 0;
+                group_mask = ~0ull;
             }
+        });
+        return sums;
+    }
+
+    /**
+     * The original std::set based solution, kept as a reference for sum_priorities.
+     */
+    priority_sums sum_priorities_with_sets(std::istream &input) {
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(input, line)) {
+            lines.push_back(line);
+        }
+
+        priority_sums sums{0, 0};
+        for (auto &l: lines) {
             std::set<char> compartment1;
             std::set<char> compartment2;
-            for (auto i = 0; i < line.length() / 2; ++i) {
-                compartment1.insert(line[i]);
+            for (auto i = 0; i < l.length() / 2; ++i) {
+                compartment1.insert(l[i]);
             }
-            for (auto i = line.length() / 2; i < line.length(); ++i) {
-                compartment2.insert(line[i]);
+            for (auto i = l.length() / 2; i < l.length(); ++i) {
+                compartment2.insert(l[i]);
             }
             std::vector<char> common;
             std::set_intersection(compartment1.begin(), compartment1.end(),
                                   compartment2.begin(), compartment2.end(),
                                   std::back_inserter(common));
-            auto priority = item_priority(common.at(0));
-            sum += priority;
+            sums.part1 += item_priority(common.at(0));
         }
 
-        std::cout << sum << "\n";
+        const int groupSize = 3;
+        for (auto g = 0; g + groupSize <= lines.size(); g += groupSize) {
+            std::set<char> intersected(lines[g].begin(), lines[g].end());
+            for (auto i = 1; i < groupSize; ++i) {
+                std::set<char> result;
+                std::set<char> temp(lines[g + i].begin(), lines[g + i].end());
+                std::set_intersection(
+                        intersected.begin(), intersected.end(),
+                        temp.begin(), temp.end(),
+                        std::inserter(result, result.end())
+                );
+                std::swap(intersected, result);
+            }
+            sums.part2 += item_priority(*intersected.begin());
+        }
+        return sums;
     }
 
-    TEST(Day3, Part2) {
-        std::ifstream input;
-        input.open("../../test/input/day3.txt");
-        auto sum = 0;
-        while (true) {
-            const int groupSize = 3;
-
-            std::set<char> intersected;
-            for (auto i = 0; i < groupSize; ++i) {
-                std::string line;
-                std::getline(input, line);
-                if (i == 0) {
-                    intersected.clear();
-                    std::copy(line.begin(), line.end(), std::inserter(intersected, intersected.end()));
-                } else {
-                    std::set<char> result;
-                    std::set<char> temp;
-                    std::copy(line.begin(), line.end(), std::inserter(temp, temp.end()));
-
-                    std::set_intersection(
-                            intersected.begin(), intersected.end(),
-                            temp.begin(), temp.end(),
-                            std::inserter(result, result.end())
-                    );
-                    std::swap(intersected, result);
-                }
-            }
+    TEST(Day3, sum_priorities) {
+        std::string sample = "vJrwpWtwJgWrhcsFMMfFFhFp\n"
+                             "jqHRNqRjqzjGDLGLrsFMfFZSrLrFZsSL\n"
+                             "PmmdzqPrVvPwwTWBwg\n"
+                             "wMqvLMZHhHMvwLHjbvcjnnSBnvTQFn\n"
+                             "ttgJtRGJQctTZtZT\n"
+                             "CrZsJsPPZsGzwwsLwLmpwMDw\n";
+        auto sums = sum_priorities(sample.data(), sample.data() + sample.size());
+        ASSERT_EQ(sums.part1, 157);
+        ASSERT_EQ(sums.part2, 70);
 
-            if (!input) {
-                break;
-            }
+        std::istringstream sample_stream(sample);
+        ASSERT_EQ(sum_priorities_with_sets(sample_stream), sums);
 
-            auto priority = item_priority(*intersected.begin());
-            sum += priority;
-        }
+        mapped_file input("../../test/input/day3.txt");
+        std::istringstream input_stream{std::string(input.view())};
+        ASSERT_EQ(sum_priorities(input.begin(), input.end()), sum_priorities_with_sets(input_stream));
+    }
+
+    TEST(Day3, Part1) {
+        mapped_file input("../../test/input/day3.txt");
+        std::cout << sum_priorities(input.begin(), input.end()).part1 << "\n";
+    }
 
-        std::cout << sum << "\n";
+    TEST(Day3, Part2) {
+        mapped_file input("../../test/input/day3.txt");
+        std::cout << sum_priorities(input.begin(), input.end()).part2 << "\n";
     }
 
-}
\ No newline at end of file
+}
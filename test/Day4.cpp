@@ -1,6 +1,14 @@
 #include <gtest/gtest.h>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
 #include <fstream>
-#include <unordered_set>
+#include <random>
+#include <sstream>
+#include "interval_index.h"
+#include "mapped_file.h"
+#include "scan.h"
+#include "simd.h"
 
 namespace day4 {
 
@@ -14,54 +22,323 @@ namespace day4 {
         return range1.second >= range2.first && range1.first <= range2.second;
     }
 
-    TEST(Day4, Part1) {
-        std::ifstream input;
-        input.open("../../test/input/day4.txt");
+    /**
+     * Assignment pairs stored column by column, so the counting kernels can load several pairs at once.
+     */
+    struct range_pairs {
+        std::vector<int32_t> afrom;
+        std::vector<int32_t> ato;
+        std::vector<int32_t> bfrom;
+        std::vector<int32_t> bto;
+
+        [[nodiscard]] size_t size() const { return afrom.size(); }
 
-        int countOverlapping = 0;
+        void push_back(range a, range b) {
+            afrom.push_back(a.first);
+            ato.push_back(a.second);
+            bfrom.push_back(b.first);
+            bto.push_back(b.second);
+        }
+
+        void clear() {
+            afrom.clear();
+            ato.clear();
+            bfrom.clear();
+            bto.clear();
+        }
+    };
 
-        while (true) {
-            int afrom, ato;
-            int bfrom, bto;
-            char junk;
-            input >> afrom >> junk >> ato >> junk >> bfrom >> junk >> bto;
-            if (!input) {
-                break;
+    /**
+     * Appends each "a-b,c-d" line in [begin, end) to pairs. Blank lines are skipped.
+     */
+    void parse_range_pairs(const char *begin, const char *end, range_pairs &pairs) {
+        for_each_line(begin, end, [&](const char *p, const char *line_end) {
+            if (line_end > p && line_end[-1] == '\r') {
+                --line_end;
+            }
+            if (p == line_end) {
+                return;
             }
-            auto range1 = std::pair(afrom, ato);
-            auto range2 = std::pair(bfrom, bto);
+            int32_t values[4];
+            for (int i = 0; i < 4; ++i) {
+                auto [next, error] = std::from_chars(p, line_end, values[i]);
+                const char separator = i == 1 ? ',' : '-';
+                bool bad_end = i < 3 ? next == line_end || *next != separator : next != line_end;
+                if (error != std::errc() || bad_end) {
+                    throw std::logic_error("invalid");
+                }
+                p = next + 1;
+            }
+            pairs.push_back({values[0], values[1]}, {values[2], values[3]});
+        });
+    }
+
+    range_pairs parse_range_pairs(const char *begin, const char *end) {
+        range_pairs pairs;
+        parse_range_pairs(begin, end, pairs);
+        return pairs;
+    }
 
-            if (fullyContains(range1, range2) || fullyContains(range2, range1)) {
-                countOverlapping++;
+    struct pair_counts {
+        long containing;
+        long overlapping;
+
+        pair_counts &operator+=(const pair_counts &b) {
+            containing += b.containing;
+            overlapping += b.overlapping;
+            return *this;
+        }
+    };
+
+#ifdef SIMD_X86
+    /**
+     * count_pairs over the pairs from i on, 8 at a time, for as many whole groups of 8 as there are. Advances i
+     * past the pairs it counted.
+     */
+    __attribute__((target("avx2")))
+    void count_pairs_avx2(const range_pairs &pairs, size_t &i, pair_counts &counts) {
+        for (; i + 8 <= pairs.size(); i += 8) {
+            auto afrom = _mm256_loadu_si256((const __m256i *) &pairs.afrom[i]);
+            auto ato = _mm256_loadu_si256((const __m256i *) &pairs.ato[i]);
+            auto bfrom = _mm256_loadu_si256((const __m256i *) &pairs.bfrom[i]);
+            auto bto = _mm256_loadu_si256((const __m256i *) &pairs.bto[i]);
+            // a doesn't contain b, b doesn't contain a, and the ranges are disjoint
+            auto a_misses_b = _mm256_or_si256(_mm256_cmpgt_epi32(afrom, bfrom), _mm256_cmpgt_epi32(bto, ato));
+            auto b_misses_a = _mm256_or_si256(_mm256_cmpgt_epi32(bfrom, afrom), _mm256_cmpgt_epi32(ato, bto));
+            auto disjoint = _mm256_or_si256(_mm256_cmpgt_epi32(bfrom, ato), _mm256_cmpgt_epi32(afrom, bto));
+            auto neither_contains = _mm256_and_si256(a_misses_b, b_misses_a);
+            counts.containing += 8 - __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(neither_contains)));
+            counts.overlapping += 8 - __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(disjoint)));
+        }
+    }
+
+    /**
+     * count_pairs_avx2, 4 at a time.
+     */
+    __attribute__((target("sse2")))
+    void count_pairs_sse2(const range_pairs &pairs, size_t &i, pair_counts &counts) {
+        for (; i + 4 <= pairs.size(); i += 4) {
+            auto afrom = _mm_loadu_si128((const __m128i *) &pairs.afrom[i]);
+            auto ato = _mm_loadu_si128((const __m128i *) &pairs.ato[i]);
+            auto bfrom = _mm_loadu_si128((const __m128i *) &pairs.bfrom[i]);
+            auto bto = _mm_loadu_si128((const __m128i *) &pairs.bto[i]);
+            auto a_misses_b = _mm_or_si128(_mm_cmpgt_epi32(afrom, bfrom), _mm_cmpgt_epi32(bto, ato));
+            auto b_misses_a = _mm_or_si128(_mm_cmpgt_epi32(bfrom, afrom), _mm_cmpgt_epi32(ato, bto));
+            auto disjoint = _mm_or_si128(_mm_cmpgt_epi32(bfrom, ato), _mm_cmpgt_epi32(afrom, bto));
+            auto neither_contains = _mm_and_si128(a_misses_b, b_misses_a);
+            counts.containing += 4 - __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(neither_contains)));
+            counts.overlapping += 4 - __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(disjoint)));
+        }
+    }
+#endif
+
+    /**
+     * Counts the pairs where one range fully contains the other, and the pairs that overlap at all, in one pass.
+     * 8 pairs (AVX2) or 4 pairs (SSE2) are compared at a time, and each comparison mask is turned into a count
+     * with movemask + popcount.
+     */
+    pair_counts count_pairs(const range_pairs &pairs, simd_kernel kernel = best_kernel()) {
+        pair_counts counts{0, 0};
+        size_t i = 0;
+#ifdef SIMD_X86
+        if (kernel == simd_kernel::avx2) {
+            count_pairs_avx2(pairs, i, counts);
+        } else if (kernel != simd_kernel::scalar) {
+            count_pairs_sse2(pairs, i, counts);
+        }
+#endif
+        for (; i < pairs.size(); ++i) {
+            range a{pairs.afrom[i], pairs.ato[i]};
+            range b{pairs.bfrom[i], pairs.bto[i]};
+            counts.containing += fullyContains(a, b) || fullyContains(b, a);
+            counts.overlapping += overlaps(a, b);
+        }
+        return counts;
+    }
+
+    /**
+     * Same as count_pairs, but reads the input a block at a time so only one block's worth of pairs is ever held
+     * in memory.
+     */
+    pair_counts count_pairs(std::istream &input, size_t block_size = 1 << 20) {
+        pair_counts counts{0, 0};
+        std::vector<char> buffer(block_size);
+        range_pairs pairs;
+        size_t carried = 0;
+        while (input) {
+            if (carried == buffer.size()) {
+                buffer.resize(buffer.size() * 2);
+            }
+            input.read(buffer.data() + carried, (std::streamsize) (buffer.size() - carried));
+            auto filled = carried + input.gcount();
+            // Only parse up to the last complete line; the rest waits for the next block
+            auto parse_end = buffer.data() + filled;
+            if (input) {
+                while (parse_end > buffer.data() && parse_end[-1] != '\n') {
+                    --parse_end;
+                }
             }
+            pairs.clear();
+            parse_range_pairs(buffer.data(), parse_end, pairs);
+            counts += count_pairs(pairs);
+            carried = buffer.data() + filled - parse_end;
+            std::copy(parse_end, parse_end + carried, buffer.data());
         }
+        return counts;
+    }
 
-        std::cout << countOverlapping << std::endl;
+    /**
+     * Every elf's assignment, both halves of each pair.
+     */
+    std::vector<range> assignments(const range_pairs &pairs) {
+        std::vector<range> result;
+        for (size_t i = 0; i < pairs.size(); ++i) {
+            result.emplace_back(pairs.afrom[i], pairs.ato[i]);
+            result.emplace_back(pairs.bfrom[i], pairs.bto[i]);
+        }
+        return result;
     }
 
-    TEST(Day4, Part2) {
-        std::ifstream input;
-        input.open("../../test/input/day4.txt");
+    /**
+     * The sections both elves of a pair are assigned to, for each pair that overlaps. An index over these
+     * answers "how many pairs overlap at section s".
+     */
+    std::vector<range> pair_overlaps(const range_pairs &pairs) {
+        std::vector<range> result;
+        for (size_t i = 0; i < pairs.size(); ++i) {
+            range a{pairs.afrom[i], pairs.ato[i]};
+            range b{pairs.bfrom[i], pairs.bto[i]};
+            if (overlaps(a, b)) {
+                result.emplace_back(std::max(a.first, b.first), std::min(a.second, b.second));
+            }
+        }
+        return result;
+    }
+
+    /**
+     * The number of overlapping pairs that both include section, by checking every pair.
+     */
+    int count_overlapping_at(const range_pairs &pairs, int section) {
+        int count = 0;
+        for (size_t p = 0; p < pairs.size(); ++p) {
+            range a{pairs.afrom[p], pairs.ato[p]};
+            range b{pairs.bfrom[p], pairs.bto[p]};
+            count += overlaps(a, b) && overlaps(a, {section, section}) && overlaps(b, {section, section});
+        }
+        return count;
+    }
+
+    const std::string sample_input = "2-4,6-8\n"
+                                     "2-3,4-5\n"
+                                     "5-7,7-9\n"
+                                     "2-8,3-7\n"
+                                     "6-6,4-6\n"
+                                     "2-6,4-8\n";
+
+    TEST(Day4, count_pairs) {
+        auto counts = count_pairs(parse_range_pairs(sample_input.data(), sample_input.data() + sample_input.size()));
+        ASSERT_EQ(counts.containing, 2);
+        ASSERT_EQ(counts.overlapping, 4);
 
-        int counterIntersecting = 0;
+        for (std::string bad: {"1-2,3-4xyz\n", "1-2,3-4 \n", "1-2,3-4,5-6\n", "1-2,3\n", "1-2;3-4\n"}) {
+            ASSERT_THROW(parse_range_pairs(bad.data(), bad.data() + bad.size()), std::logic_error);
+        }
+        std::string crlf = "1-2,3-4\r\n\n";
+        ASSERT_EQ(parse_range_pairs(crlf.data(), crlf.data() + crlf.size()).size(), 1);
 
-        while (true) {
-            int afrom, ato;
-            int bfrom, bto;
-            char junk;
-            input >> afrom >> junk >> ato >> junk >> bfrom >> junk >> bto;
-            if (!input) {
-                break;
+        std::mt19937 random(1);
+        std::uniform_int_distribution<int> section(1, 99);
+        for (int length: {1, 3, 4, 5, 8, 9, 17, 1000}) {
+            std::string input;
+            long containing = 0;
+            long overlapping = 0;
+            for (int i = 0; i < length; ++i) {
+                auto a = std::minmax(section(random), section(random));
+                auto b = std::minmax(section(random), section(random));
+                input += std::to_string(a.first) + "-" + std::to_string(a.second) + "," +
+                         std::to_string(b.first) + "-" + std::to_string(b.second) + "\n";
+                containing += fullyContains(a, b) || fullyContains(b, a);
+                overlapping += overlaps(a, b);
+            }
+            auto pairs = parse_range_pairs(input.data(), input.data() + input.size());
+            for (auto kernel: supported_kernels()) {
+                counts = count_pairs(pairs, kernel);
+                ASSERT_EQ(counts.containing, containing);
+                ASSERT_EQ(counts.overlapping, overlapping);
             }
-            auto range1 = std::pair(afrom, ato);
-            auto range2 = std::pair(bfrom, bto);
 
-            if (overlaps(range1, range2)) {
-                counterIntersecting++;
+            for (size_t block_size: {1, 7, 64}) {
+                std::istringstream stream(input);
+                counts = count_pairs(stream, block_size);
+                ASSERT_EQ(counts.containing, containing);
+                ASSERT_EQ(counts.overlapping, overlapping);
             }
         }
+    }
+
+    TEST(Day4, interval_index) {
+        auto sample = parse_range_pairs(sample_input.data(), sample_input.data() + sample_input.size());
+        interval_index sample_assignments(assignments(sample));
+        ASSERT_EQ(sample_assignments.count_containing(6), 8);
+        ASSERT_EQ(sample_assignments.count_within(2, 4), 2);
+        interval_index sample_overlaps(pair_overlaps(sample));
+        ASSERT_EQ(sample_overlaps.size(), 4);
+        ASSERT_EQ(sample_overlaps.count_containing(6), 3);
+        ASSERT_EQ(sample_overlaps.count_containing(7), 2);
+
+        mapped_file input("../../test/input/day4.txt");
+        auto pairs = parse_range_pairs(input.begin(), input.end());
+        interval_index index(pair_overlaps(pairs));
+        ASSERT_EQ(index.size(), count_pairs(pairs).overlapping);
+
+        for (int section = 0; section <= 100; ++section) {
+            ASSERT_EQ(index.count_containing(section), count_overlapping_at(pairs, section));
+        }
+    }
 
-        std::cout << counterIntersecting << std::endl;
+    TEST(Day4, DISABLED_interval_index_benchmark) {
+        mapped_file input("../../test/input/day4.txt");
+        auto pairs = parse_range_pairs(input.begin(), input.end());
+        interval_index index(pair_overlaps(pairs));
+
+        const int iterations = 20;
+        auto p_as_float = (double) std::chrono::steady_clock::period::num / (double) std::chrono::steady_clock::period::den;
+        std::vector<int> rescanned;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            rescanned.clear();
+            for (int section = 0; section <= 100; ++section) {
+                rescanned.push_back(count_overlapping_at(pairs, section));
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        std::cout << "rescan seconds per query: " << ((end - start).count() * p_as_float / iterations / 101) << std::endl;
+
+        std::vector<int> indexed;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            indexed.clear();
+            for (int section = 0; section <= 100; ++section) {
+                indexed.push_back(index.count_containing(section));
+            }
+        }
+        end = std::chrono::steady_clock::now();
+        std::cout << "index seconds per query: " << ((end - start).count() * p_as_float / iterations / 101) << std::endl;
+
+        ASSERT_EQ(indexed, rescanned);
+    }
+
+    TEST(Day4, Part1) {
+        mapped_file input("../../test/input/day4.txt");
+        auto counts = count_pairs(parse_range_pairs(input.begin(), input.end()));
+        std::cout << counts.containing << std::endl;
+    }
+
+    TEST(Day4, Part2) {
+        std::ifstream input;
+        input.open("../../test/input/day4.txt");
+        auto counts = count_pairs(input);
+        std::cout << counts.overlapping << std::endl;
     }
 
-}
\ No newline at end of file
+}
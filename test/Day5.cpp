@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
+#include <chrono>
 #include <fstream>
+#include <random>
 #include <regex>
+#include <sstream>
 
 using namespace std;
 
@@ -17,9 +20,7 @@ namespace day5 {
         vector<theMove> moves;
     };
 
-    puzzleInput parseInput() {
-        ifstream input;
-        input.open("../../test/input/day5.txt");
+    puzzleInput parseInput(istream &input) {
         regex crateLineRegex(R"((\[\w\] *)*)");
         regex blankRegex(R"(\s*)");
         regex crate_regex(R"(\[(\w)\])");
@@ -63,44 +64,355 @@ namespace day5 {
         return puzIn;
     }
 
-    TEST(Day5, Part1) {
-        auto puzIn = parseInput();
+    puzzleInput parseInput() {
+        ifstream input;
+        input.open("../../test/input/day5.txt");
+        return parseInput(input);
+    }
 
-        for (const auto &item: puzIn.moves) {
-            for (auto i = 0; i < item.count; ++i) {
-                auto moved = puzIn.crates[item.from].back();
-                puzIn.crates[item.from].pop_back();
-                puzIn.crates[item.to].push_back(moved);
+    /**
+     * All of the crate stacks, each one an implicit-key treap (ordered bottom to top) over a shared node pool.
+     * Moving N crates splits them off the top of one treap and merges them onto another, which is O(log n)
+     * expected however large N is. The CrateMover 9000 moves crates one at a time, which reverses them; that's
+     * a lazy flag on the moved subtree, so it costs nothing extra.
+     */
+    class crate_stacks {
+    private:
+        struct node {
+            char crate;
+            uint32_t priority;
+            int left;
+            int right;
+            int size;
+            bool reversed;
+        };
+
+        vector<node> nodes;
+        vector<int> roots;
+        mt19937 random;
+
+        int size_of(int t) const {
+            return t < 0 ? 0 : nodes[t].size;
+        }
+
+        void update(int t) {
+            nodes[t].size = 1 + size_of(nodes[t].left) + size_of(nodes[t].right);
+        }
+
+        void push_down(int t) {
+            auto &n = nodes[t];
+            if (n.reversed) {
+                swap(n.left, n.right);
+                if (n.left >= 0) {
+                    nodes[n.left].reversed = !nodes[n.left].reversed;
+                }
+                if (n.right >= 0) {
+                    nodes[n.right].reversed = !nodes[n.right].reversed;
+                }
+                n.reversed = false;
             }
         }
 
-        // HNSNMTLHQ correct
-        for (const auto &item: puzIn.crates) {
-            cout << item.back();
+        int merge(int a, int b) {
+            if (a < 0) {
+                return b;
+            }
+            if (b < 0) {
+                return a;
+            }
+            if (nodes[a].priority > nodes[b].priority) {
+                push_down(a);
+                nodes[a].right = merge(nodes[a].right, b);
+                update(a);
+                return a;
+            } else {
+                push_down(b);
+                nodes[b].left = merge(a, nodes[b].left);
+                update(b);
+                return b;
+            }
         }
-        cout << endl;
 
-    }
+        /**
+         * Splits t into its first count elements and the rest.
+         */
+        pair<int, int> split(int t, int count) {
+            if (t < 0) {
+                return {-1, -1};
+            }
+            push_down(t);
+            if (size_of(nodes[t].left) >= count) {
+                auto [l, r] = split(nodes[t].left, count);
+                nodes[t].left = r;
+                update(t);
+                return {l, t};
+            } else {
+                auto [l, r] = split(nodes[t].right, count - size_of(nodes[t].left) - 1);
+                nodes[t].right = l;
+                update(t);
+                return {t, r};
+            }
+        }
 
-    TEST(Day5, Part2) {
-        auto puzIn = parseInput();
+    public:
+        explicit crate_stacks(const vector<vector<char>> &stacks, unsigned seed = 5) : random(seed) {
+            for (auto &stack: stacks) {
+                int root = -1;
+                for (auto crate: stack) {
+                    nodes.push_back({crate, (uint32_t) random(), -1, -1, 1, false});
+                    root = merge(root, (int) nodes.size() - 1);
+                }
+                roots.push_back(root);
+            }
+        }
+
+        [[nodiscard]] size_t stack_count() const { return roots.size(); }
 
-        for (auto i = 0; i < puzIn.moves.size(); ++i) {
-            auto item = puzIn.moves[i];
+        [[nodiscard]] int stack_size(int stack) const { return size_of(roots[stack]); }
+
+        /**
+         * Moves the top m.count crates from m.from to m.to. keep_order is false for the CrateMover 9000, which
+         * moves them one at a time, and true for the 9001, which moves them all at once.
+         */
+        void move(const theMove &m, bool keep_order) {
+            if (m.count > stack_size(m.from)) {
+                throw logic_error("not enough crates");
+            }
+            auto [rest, moved] = split(roots[m.from], stack_size(m.from) - m.count);
+            if (!keep_order && moved >= 0) {
+                nodes[moved].reversed = !nodes[moved].reversed;
+            }
+            roots[m.from] = rest;
+            roots[m.to] = merge(roots[m.to], moved);
+        }
+
+        /**
+         * The top crate of the stack, or ' ' if it's empty.
+         */
+        [[nodiscard]] char top(int stack) const {
+            int t = roots[stack];
+            if (t < 0) {
+                return ' ';
+            }
+            // Follow the rightmost path, tracking whether the subtree we're in has been reversed
+            bool reversed = false;
+            while (true) {
+                reversed ^= nodes[t].reversed;
+                int next = reversed ? nodes[t].left : nodes[t].right;
+                if (next < 0) {
+                    return nodes[t].crate;
+                }
+                t = next;
+            }
+        }
+
+        [[nodiscard]] string tops() const {
+            string result;
+            for (int i = 0; i < roots.size(); ++i) {
+                result += top(i);
+            }
+            return result;
+        }
+    };
+
+    /**
+     * The tops of the stacks after running every move directly on vectors, one crate at a time for the
+     * CrateMover 9000 and as one block for the 9001.
+     */
+    string simulate_with_vectors(puzzleInput puzIn, bool keep_order) {
+        for (const auto &item: puzIn.moves) {
             auto &source = puzIn.crates[item.from];
             auto &dest = puzIn.crates[item.to];
-            auto end = source.end();
-            auto start = end - item.count;
-            copy(start, end, back_inserter(dest));
-            source.erase(start, end);
+            if (keep_order) {
+                auto end = source.end();
+                auto start = end - item.count;
+                copy(start, end, back_inserter(dest));
+                source.erase(start, end);
+            } else {
+                for (auto i = 0; i < item.count; ++i) {
+                    auto moved = source.back();
+                    source.pop_back();
+                    dest.push_back(moved);
+                }
+            }
         }
-
-        //RNLFDJMCT correct
+        string result;
         for (const auto &item: puzIn.crates) {
-            cout << item.back();
+            result += item.empty() ? ' ' : item.back();
         }
-        cout << endl;
+        return result;
+    }
+
+    string simulate(const puzzleInput &puzIn, bool keep_order) {
+        crate_stacks stacks(puzIn.crates);
+        for (const auto &item: puzIn.moves) {
+            stacks.move(item, keep_order);
+        }
+        return stacks.tops();
+    }
+
+    /**
+     * The tops of the stacks, found by walking the moves backwards from each final top crate to the position it
+     * started in. Only one position per stack is tracked, so this costs O(moves * stacks) no matter how many
+     * crates each move carries.
+     */
+    string trace_tops(const puzzleInput &puzIn, bool keep_order) {
+        // Forward pass over the counts only, to know which stacks end up empty
+        vector<int> sizes;
+        for (auto &stack: puzIn.crates) {
+            sizes.push_back((int) stack.size());
+        }
+        for (auto &m: puzIn.moves) {
+            sizes[m.from] -= m.count;
+            sizes[m.to] += m.count;
+        }
+
+        // Position of each final top crate as (stack, depth below the top of that stack)
+        vector<pair<int, int>> positions;
+        for (int stack = 0; stack < sizes.size(); ++stack) {
+            positions.emplace_back(stack, 0);
+        }
+        for (auto iter = puzIn.moves.rbegin(); iter != puzIn.moves.rend(); ++iter) {
+            auto &m = *iter;
+            for (auto &[stack, depth]: positions) {
+                if (stack == m.to) {
+                    if (depth < m.count) {
+                        stack = m.from;
+                        depth = keep_order ? depth : m.count - 1 - depth;
+                    } else {
+                        depth -= m.count;
+                    }
+                } else if (stack == m.from) {
+                    depth += m.count;
+                }
+            }
+        }
+
+        string result;
+        for (int stack = 0; stack < sizes.size(); ++stack) {
+            if (sizes[stack] == 0) {
+                result += ' ';
+            } else {
+                auto [original, depth] = positions[stack];
+                auto &crates = puzIn.crates[original];
+                result += crates[crates.size() - 1 - depth];
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Random stacks of A-Z crates and random moves between them, each moving up to max_count crates.
+     */
+    puzzleInput generate_input(int stack_count, int crate_count, int move_count, int max_count, unsigned seed) {
+        mt19937 random(seed);
+        puzzleInput puzIn;
+        puzIn.crates.resize(stack_count);
+        for (int i = 0; i < crate_count; ++i) {
+            puzIn.crates[random() % stack_count].push_back(char('A' + random() % 26));
+        }
+        vector<int> sizes;
+        for (auto &stack: puzIn.crates) {
+            sizes.push_back((int) stack.size());
+        }
+        for (int i = 0; i < move_count; ++i) {
+            int from = (int) (random() % stack_count);
+            int to = (int) (random() % (stack_count - 1));
+            to += to >= from;
+            int count = min(sizes[from], 1 + (int) (random() % max_count));
+            sizes[from] -= count;
+            sizes[to] += count;
+            puzIn.moves.push_back({count, from, to});
+        }
+        return puzIn;
+    }
+
+    const string sample_input = "    [D]    \n"
+                                "[N] [C]    \n"
+                                "[Z] [M] [P]\n"
+                                " 1   2   3 \n"
+                                "\n"
+                                "move 1 from 2 to 1\n"
+                                "move 3 from 1 to 3\n"
+                                "move 2 from 2 to 1\n"
+                                "move 1 from 1 to 2\n";
+
+    TEST(Day5, crate_stacks) {
+        istringstream input(sample_input);
+        auto sample = parseInput(input);
+        ASSERT_EQ(simulate(sample, false), "CMZ");
+        ASSERT_EQ(simulate(sample, true), "MCD");
 
+        for (unsigned seed = 1; seed <= 20; ++seed) {
+            auto generated = generate_input(9, 2000, 1000, 50 * seed, seed);
+            ASSERT_EQ(simulate(generated, false), simulate_with_vectors(generated, false));
+            ASSERT_EQ(simulate(generated, true), simulate_with_vectors(generated, true));
+        }
+    }
+
+    TEST(Day5, trace_tops) {
+        istringstream input(sample_input);
+        auto sample = parseInput(input);
+        ASSERT_EQ(trace_tops(sample, false), "CMZ");
+        ASSERT_EQ(trace_tops(sample, true), "MCD");
+
+        auto puzIn = parseInput();
+        ASSERT_EQ(trace_tops(puzIn, false), simulate(puzIn, false));
+        ASSERT_EQ(trace_tops(puzIn, true), simulate(puzIn, true));
+
+        for (unsigned seed = 1; seed <= 20; ++seed) {
+            // Few crates and many stacks, so some stacks end up empty
+            auto generated = generate_input(seed % 2 ? 9 : 30, seed % 2 ? 2000 : 40, 1000, 50 * seed, seed);
+            ASSERT_EQ(trace_tops(generated, false), simulate_with_vectors(generated, false));
+            ASSERT_EQ(trace_tops(generated, true), simulate_with_vectors(generated, true));
+        }
+    }
+
+    TEST(Day5, DISABLED_trace_tops_benchmark) {
+        auto generated = generate_input(9, 1000000, 400, 1000000, 2);
+        auto p_as_float = (double) chrono::steady_clock::period::num / (double) chrono::steady_clock::period::den;
+
+        auto start = chrono::steady_clock::now();
+        auto by_vectors = simulate_with_vectors(generated, false);
+        auto end = chrono::steady_clock::now();
+        cout << "vector simulation seconds: " << ((end - start).count() * p_as_float) << endl;
+
+        start = chrono::steady_clock::now();
+        auto by_treaps = simulate(generated, false);
+        end = chrono::steady_clock::now();
+        cout << "treap simulation seconds: " << ((end - start).count() * p_as_float) << endl;
+
+        start = chrono::steady_clock::now();
+        auto traced = trace_tops(generated, false);
+        end = chrono::steady_clock::now();
+        cout << "backward trace seconds: " << ((end - start).count() * p_as_float) << endl;
+
+        ASSERT_EQ(traced, by_vectors);
+        ASSERT_EQ(traced, by_treaps);
+    }
+
+    TEST(Day5, DISABLED_crate_stacks_large) {
+        auto generated = generate_input(9, 2000000, 500000, 1000000, 1);
+        auto p_as_float = (double) chrono::steady_clock::period::num / (double) chrono::steady_clock::period::den;
+        auto start = chrono::steady_clock::now();
+        auto tops = simulate(generated, true);
+        auto end = chrono::steady_clock::now();
+        cout << "crates: 2000000, moves: 500000, seconds: " << ((end - start).count() * p_as_float) << endl;
+        ASSERT_EQ(tops.size(), 9);
+    }
+
+    TEST(Day5, Part1) {
+        auto puzIn = parseInput();
+
+        // HNSNMTLHQ correct
+        cout << simulate(puzIn, false) << endl;
+    }
+
+    TEST(Day5, Part2) {
+        auto puzIn = parseInput();
+
+        //RNLFDJMCT correct
+        cout << simulate(puzIn, true) << endl;
     }
 
-}
\ No newline at end of file
+}
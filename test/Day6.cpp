@@ -1,26 +1,239 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <fstream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
 
 using namespace std;
 
 namespace day6 {
 
+    /**
+     * Position just past the first window of message_size distinct characters, or -1 if there isn't one.
+     *
+     * Slides the window start forward past the previous occurrence of each new character, so every character
+     * is looked at once regardless of the window size.
+     */
     int find_marker_pos(const string &line, int message_size) {
+        array<int, 256> last_seen{};
+        last_seen.fill(-1);
+        int start = 0;
+        for (int i = 0; i < line.length(); ++i) {
+            auto c = (unsigned char) line[i];
+            start = max(start, last_seen[c] + 1);
+            last_seen[c] = i;
+            if (i - start + 1 == message_size) {
+                return i + 1;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * The original set-per-offset version, with the last window included, as a reference.
+     */
+    int find_marker_pos_with_sets(const string &line, int message_size) {
         set<char> seen;
-        int i = 0;
-        for (; i < line.length() - message_size; ++i) {
+        for (int i = 0; i + message_size <= line.length(); ++i) {
             seen.clear();
             for (auto j = 0; j < message_size; ++j) {
                 seen.insert(line[i + j]);
             }
             if (seen.size() == message_size) {
-                break;
+                return i + message_size;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Finds markers in a stream of any length that arrives in blocks, for several window sizes at once.
+     *
+     * The last k characters are all distinct exactly when the longest run of distinct characters ending at the
+     * current one is at least k long, so one run start serves every window size. The only state is that start
+     * and the last position of each byte value, so memory use doesn't depend on the stream length.
+     */
+    class marker_scanner {
+    private:
+        vector<int> window_sizes;
+        array<long long, 256> last_seen{};
+        long long offset{0};
+        long long run_start{0};
+
+    public:
+        explicit marker_scanner(vector<int> window_sizes) : window_sizes(std::move(window_sizes)) {
+            last_seen.fill(-1);
+        }
+
+        /**
+         * Number of characters fed so far.
+         */
+        [[nodiscard]] long long position() const { return offset; }
+
+        /**
+         * Scans the next block of the stream, calling on_marker(window_size, position) for every window size
+         * and every position (counted from the start of the stream, just past the window) where the last
+         * window_size characters are distinct.
+         */
+        template <typename F>
+        void feed(const char *data, size_t size, F on_marker) {
+            for (size_t i = 0; i < size; ++i, ++offset) {
+                auto c = (unsigned char) data[i];
+                run_start = max(run_start, last_seen[c] + 1);
+                last_seen[c] = offset;
+                auto run = offset - run_start + 1;
+                for (auto window_size: window_sizes) {
+                    if (run >= window_size) {
+                        on_marker(window_size, offset + 1);
+                    }
+                }
+            }
+        }
+    };
+
+    /**
+     * Reads input block_size bytes at a time until it runs out, feeding each block to scanner. Line terminators
+     * ('\n' and '\r') aren't part of the signal, so they're dropped, and positions only count signal bytes.
+     */
+    template <typename F>
+    void scan_markers(istream &input, marker_scanner &scanner, F on_marker, size_t block_size = 1 << 16) {
+        vector<char> buffer(block_size);
+        while (input) {
+            input.read(buffer.data(), (streamsize) buffer.size());
+            auto end = buffer.data() + input.gcount();
+            auto p = buffer.data();
+            while (p < end) {
+                auto run_end = find_if(p, end, [](char c) { return c == '\n' || c == '\r'; });
+                scanner.feed(p, run_end - p, on_marker);
+                p = find_if(run_end, end, [](char c) { return c != '\n' && c != '\r'; });
+            }
+        }
+    }
+
+    /**
+     * size random characters drawn from the first alphabet_size letters.
+     */
+    string generate_signal(size_t size, int alphabet_size, unsigned seed) {
+        mt19937 random(seed);
+        string result(size, ' ');
+        for (auto &c: result) {
+            c = char('a' + random() % alphabet_size);
+        }
+        return result;
+    }
+
+    TEST(Day6, find_marker_pos) {
+        ASSERT_EQ(find_marker_pos("mjqjpqmgbljsphdztnvjfqwrcgsmlb", 4), 7);
+        ASSERT_EQ(find_marker_pos("bvwbjplbgvbhsrlpgdmjqwftvncz", 4), 5);
+        ASSERT_EQ(find_marker_pos("nznrnfrfntjfmvfwmzdfjlvtqnbhcprsg", 14), 29);
+        ASSERT_EQ(find_marker_pos("zcfzfwzzqfrljwzlrfnpqdbhtmscgvjw", 14), 26);
+
+        // The marker is the very last window
+        ASSERT_EQ(find_marker_pos("aaaabcd", 4), 7);
+        ASSERT_EQ(find_marker_pos("aaaa", 4), -1);
+        ASSERT_EQ(find_marker_pos("", 1), -1);
+
+        for (unsigned seed = 1; seed <= 200; ++seed) {
+            int message_size = 1 + (int) seed % 20;
+            auto signal = generate_signal(200, 4 + (int) seed % 20, seed);
+            ASSERT_EQ(find_marker_pos(signal, message_size), find_marker_pos_with_sets(signal, message_size));
+        }
+
+        // Window sizes up to 64 over the full byte range
+        string bytes;
+        for (int i = 0; i < 256; ++i) {
+            bytes += char(i);
+        }
+        ASSERT_EQ(find_marker_pos(bytes, 64), 64);
+        // The last 'x' starts the window, since bytes doesn't reach 'x' within 63 characters
+        ASSERT_EQ(find_marker_pos(string(100, 'x') + bytes, 64), 100 + 63);
+    }
+
+    TEST(Day6, DISABLED_find_marker_pos_benchmark) {
+        // 13 letters can never fill a window of 14, so both versions scan the whole signal
+        auto signal = generate_signal(16 << 20, 13, 1);
+        auto p_as_float = (double) chrono::steady_clock::period::num / (double) chrono::steady_clock::period::den;
+
+        auto start = chrono::steady_clock::now();
+        auto position = find_marker_pos(signal, 14);
+        auto end = chrono::steady_clock::now();
+        cout << "sliding window seconds per MB: " << ((end - start).count() * p_as_float / 16) << endl;
+        ASSERT_EQ(position, -1);
+
+        signal.resize(128 << 10);
+        start = chrono::steady_clock::now();
+        position = find_marker_pos_with_sets(signal, 14);
+        end = chrono::steady_clock::now();
+        cout << "set per offset seconds per MB: " << ((end - start).count() * p_as_float * 8) << endl;
+        ASSERT_EQ(position, -1);
+    }
+
+    TEST(Day6, marker_scanner) {
+        for (unsigned seed = 1; seed <= 50; ++seed) {
+            auto signal = generate_signal(300, 4 + (int) seed % 20, seed);
+            for (size_t block_size: {1, 7, 4096}) {
+                marker_scanner scanner({4, 14});
+                map<int, vector<long long>> markers;
+                istringstream input(signal);
+                scan_markers(input, scanner, [&](int window_size, long long position) {
+                    markers[window_size].push_back(position);
+                }, block_size);
+                ASSERT_EQ(scanner.position(), signal.size());
+
+                // Line terminators anywhere in the input are skipped, so the markers don't change
+                marker_scanner with_terminators({4, 14});
+                map<int, vector<long long>> terminated_markers;
+                istringstream terminated(signal.substr(0, 100) + "\n" + signal.substr(100) + "\r\n");
+                scan_markers(terminated, with_terminators, [&](int window_size, long long position) {
+                    terminated_markers[window_size].push_back(position);
+                }, block_size);
+                ASSERT_EQ(with_terminators.position(), signal.size());
+                ASSERT_EQ(terminated_markers, markers);
+
+                for (int window_size: {4, 14}) {
+                    vector<long long> expected;
+                    for (int end = window_size; end <= signal.size(); ++end) {
+                        if (set<char>(signal.begin() + end - window_size, signal.begin() + end).size() == window_size) {
+                            expected.push_back(end);
+                        }
+                    }
+                    ASSERT_EQ(markers[window_size], expected);
+                    ASSERT_EQ(expected.empty() ? -1 : expected[0], find_marker_pos(signal, window_size));
+                }
             }
         }
+    }
 
-        int position = i + message_size;
+    TEST(Day6, DISABLED_marker_scanner_benchmark) {
+        // The same 1 MB block over and over stands in for an endless stream
+        auto block = generate_signal(1 << 20, 15, 2);
+        const int blocks = 16;
+        marker_scanner scanner({4, 14});
+        long long markers = 0;
+        auto p_as_float = (double) chrono::steady_clock::period::num / (double) chrono::steady_clock::period::den;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < blocks; ++i) {
+            scanner.feed(block.data(), block.size(), [&](int, long long) { ++markers; });
+        }
+        auto end = chrono::steady_clock::now();
+        cout << "markers: " << markers << ", seconds per MB: " << ((end - start).count() * p_as_float / blocks)
+             << endl;
+        ASSERT_EQ(scanner.position(), (long long) blocks << 20);
+    }
 
-        return position;
+    TEST(Day6, both_parts_streaming) {
+        ifstream input;
+        input.open("../../test/input/day6.txt");
+        marker_scanner scanner({4, 14});
+        map<int, long long> first_marker;
+        scan_markers(input, scanner, [&](int window_size, long long position) {
+            first_marker.emplace(window_size, position);
+        });
+        cout << first_marker[4] << "\n" << first_marker[14] << "\n";
     }
 
     TEST(Day6, Part1) {
@@ -46,4 +259,4 @@ namespace day6 {
         cout << position << "\n";
     }
 
-}
\ No newline at end of file
+}
@@ -1,7 +1,14 @@
 #include <gtest/gtest.h>
+#include <cstdint>
 #include <fstream>
+#include <map>
+#include <optional>
+#include <random>
 #include <regex>
+#include <sstream>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 
 using namespace std;
 
@@ -61,44 +68,295 @@ namespace day7 {
         return aggregateSize;
     }
 
-    TEST(Day7, Part1) {
-        ifstream input;
-        input.open("../../test/input/day7.txt");
+    /**
+     * The directories seen in a terminal transcript, stored in an arena indexed by id with the root at 0.
+     * Names are interned, so walking the tree never builds path strings. File sizes are added to the directory
+     * that holds them, and total_size is filled in by roll_up once the transcript has been read.
+     */
+    class directory_tree {
+    private:
+        struct directory {
+            int name;
+            int parent;
+            uint64_t file_size;
+            uint64_t total_size;
+        };
 
-        auto aggregateSize = buildAggregateSize(input);
+        vector<string> names;
+        unordered_map<string, int> name_ids;
+        vector<directory> directories{{-1, -1, 0, 0}};
+        // (parent << 32 | name) -> child directory, and the same key for files already counted
+        unordered_map<uint64_t, int> children;
+        unordered_set<uint64_t> files;
+
+        static uint64_t key(int dir, int name) {
+            return (uint64_t) dir << 32 | (uint32_t) name;
+        }
+
+        int intern(string_view name) {
+            auto [iter, inserted] = name_ids.emplace(name, (int) names.size());
+            if (inserted) {
+                names.emplace_back(name);
+            }
+            return iter->second;
+        }
+
+    public:
+        static constexpr int root = 0;
+
+        [[nodiscard]] size_t size() const { return directories.size(); }
+
+        [[nodiscard]] int parent(int dir) const { return directories[dir].parent; }
+
+        /**
+         * The named subdirectory of dir, created if it hasn't been seen yet.
+         */
+        int child(int dir, string_view name) {
+            int name_id = intern(name);
+            auto [iter, inserted] = children.emplace(key(dir, name_id), (int) directories.size());
+            if (inserted) {
+                directories.push_back({name_id, dir, 0, 0});
+            }
+            return iter->second;
+        }
+
+        /**
+         * Adds a file to dir. Listing the same directory twice doesn't count its files twice.
+         */
+        void add_file(int dir, string_view name, uint64_t size) {
+            if (files.insert(key(dir, intern(name))).second) {
+                directories[dir].file_size += size;
+            }
+        }
+
+        /**
+         * Computes every directory's total size. Children always have higher ids than their parents, so going
+         * through the arena backwards visits each directory after all of its descendants.
+         */
+        void roll_up() {
+            for (auto &dir: directories) {
+                dir.total_size = dir.file_size;
+            }
+            for (auto dir = (int) directories.size() - 1; dir > root; --dir) {
+                directories[directories[dir].parent].total_size += directories[dir].total_size;
+            }
+        }
+
+        [[nodiscard]] uint64_t total_size(int dir) const { return directories[dir].total_size; }
+
+        [[nodiscard]] string path(int dir) const {
+            if (dir == root) {
+                return "/";
+            }
+            string result;
+            for (; dir != root; dir = directories[dir].parent) {
+                result.insert(0, "/" + names[directories[dir].name]);
+            }
+            return result;
+        }
+    };
+
+    /**
+     * Directory sizes sorted once, with prefix sums, so threshold and best-fit queries are binary searches.
+     */
+    class size_index {
+    private:
+        vector<uint64_t> sizes;
+        // prefix[i] = sum of the i smallest sizes
+        vector<uint64_t> prefix{0};
+
+    public:
+        explicit size_index(vector<uint64_t> directory_sizes) : sizes(std::move(directory_sizes)) {
+            sort(sizes.begin(), sizes.end());
+            for (auto size: sizes) {
+                prefix.push_back(prefix.back() + size);
+            }
+        }
+
+        explicit size_index(const directory_tree &tree) : size_index([&]() {
+            vector<uint64_t> directory_sizes;
+            for (int dir = 0; dir < tree.size(); ++dir) {
+                directory_sizes.push_back(tree.total_size(dir));
+            }
+            return directory_sizes;
+        }()) {}
+
+        /**
+         * Total size of the directories that are at most threshold.
+         */
+        [[nodiscard]] uint64_t sum_at_most(uint64_t threshold) const {
+            return prefix[upper_bound(sizes.begin(), sizes.end(), threshold) - sizes.begin()];
+        }
+
+        [[nodiscard]] size_t count_at_most(uint64_t threshold) const {
+            return upper_bound(sizes.begin(), sizes.end(), threshold) - sizes.begin();
+        }
 
-        int sum = 0;
-        for (const auto &item: aggregateSize) {
-            if (item.second <= 100000) {
-                sum += item.second;
+        /**
+         * Size of the smallest directory that is at least needed, if there is one.
+         */
+        [[nodiscard]] optional<uint64_t> smallest_at_least(uint64_t needed) const {
+            auto found = lower_bound(sizes.begin(), sizes.end(), needed);
+            if (found == sizes.end()) {
+                return nullopt;
             }
+            return *found;
         }
+    };
 
-        cout << sum << endl;
+    /**
+     * Size of the smallest directory that frees up enough space for the update.
+     */
+    uint64_t directory_to_delete(const directory_tree &tree, const size_index &index) {
+        const uint64_t disk_size = 70000000;
+        const uint64_t needed = 30000000;
+        auto used = tree.total_size(directory_tree::root);
+        auto unused = used >= disk_size ? 0 : disk_size - used;
+        auto neededToFree = unused >= needed ? 0 : needed - unused;
+        auto found = index.smallest_at_least(neededToFree);
+        if (!found) {
+            throw logic_error("not found");
+        }
+        return *found;
     }
 
-    TEST(Day7, Part2) {
+    /**
+     * Builds the tree for a transcript of cd and ls commands. cd .. at the root stays at the root.
+     */
+    directory_tree parse_tree(istream &input) {
+        directory_tree tree;
+        int current = directory_tree::root;
+        string line;
+        while (getline(input, line)) {
+            string_view view(line);
+            if (!view.empty() && view.back() == '\r') {
+                view.remove_suffix(1);
+            }
+            if (view.substr(0, 5) == "$ cd ") {
+                auto name = view.substr(5);
+                if (name == "/") {
+                    current = directory_tree::root;
+                } else if (name == "..") {
+                    current = current == directory_tree::root ? current : tree.parent(current);
+                } else {
+                    current = tree.child(current, name);
+                }
+            } else if (view.substr(0, 4) == "dir ") {
+                tree.child(current, view.substr(4));
+            } else if (!view.empty() && isdigit(view[0])) {
+                auto space = view.find(' ');
+                if (space == string_view::npos) {
+                    throw logic_error("invalid");
+                }
+                tree.add_file(current, view.substr(space + 1), stoull(string(view.substr(0, space))));
+            }
+        }
+        tree.roll_up();
+        return tree;
+    }
+
+    const string sample_input = "$ cd /\n"
+                                "$ ls\n"
+                                "dir a\n"
+                                "14848514 b.txt\n"
+                                "8504156 c.dat\n"
+                                "dir d\n"
+                                "$ cd a\n"
+                                "$ ls\n"
+                                "dir e\n"
+                                "29116 f\n"
+                                "2557 g\n"
+                                "62596 h.lst\n"
+                                "$ cd e\n"
+                                "$ ls\n"
+                                "584 i\n"
+                                "$ cd ..\n"
+                                "$ cd ..\n"
+                                "$ cd d\n"
+                                "$ ls\n"
+                                "4060174 j\n"
+                                "8033020 d.log\n"
+                                "5626152 d.ext\n"
+                                "7214296 k\n";
+
+    TEST(Day7, directory_tree) {
+        istringstream sample(sample_input);
+        auto tree = parse_tree(sample);
+        ASSERT_EQ(tree.size(), 4);
+        map<string, uint64_t> sizes;
+        for (int dir = 0; dir < tree.size(); ++dir) {
+            sizes[tree.path(dir)] = tree.total_size(dir);
+        }
+        ASSERT_EQ(sizes, (map<string, uint64_t>{{"/", 48381165}, {"/a", 94853}, {"/a/e", 584}, {"/d", 24933642}}));
+
+        // Listing a directory again, or going up past the root, doesn't change anything
+        istringstream repeated(sample_input + "$ cd ..\n$ cd ..\n$ cd d\n$ ls\n4060174 j\n");
+        ASSERT_EQ(parse_tree(repeated).total_size(directory_tree::root), 48381165);
+
+        // Sizes past 32 bits
+        istringstream large("$ cd /\n$ ls\n3000000000 a\n3000000000 b\n");
+        ASSERT_EQ(parse_tree(large).total_size(directory_tree::root), 6000000000ull);
+
         ifstream input;
         input.open("../../test/input/day7.txt");
-
+        tree = parse_tree(input);
+        input.clear();
+        input.seekg(0);
         auto aggregateSize = buildAggregateSize(input);
+        ASSERT_EQ(tree.size(), aggregateSize.size());
+        for (int dir = 0; dir < tree.size(); ++dir) {
+            ASSERT_EQ(tree.total_size(dir), aggregateSize.at(tree.path(dir)));
+        }
+    }
 
-        vector<pair<string, int>> pairs;
-        copy(aggregateSize.begin(), aggregateSize.end(), back_inserter(pairs));
+    TEST(Day7, size_index) {
+        istringstream sample(sample_input);
+        auto tree = parse_tree(sample);
+        size_index index(tree);
+        ASSERT_EQ(index.sum_at_most(100000), 95437);
+        ASSERT_EQ(index.count_at_most(100000), 2);
+        ASSERT_EQ(directory_to_delete(tree, index), 24933642);
+        ASSERT_EQ(index.smallest_at_least(48381166), nullopt);
 
-        sort(pairs.begin(), pairs.end(), [](auto a, auto b) { return a.second < b.second; });
+        mt19937 random(1);
+        vector<uint64_t> sizes;
+        for (int i = 0; i < 500; ++i) {
+            sizes.push_back(random() % 100000);
+        }
+        size_index random_index(sizes);
+        for (int i = 0; i < 500; ++i) {
+            uint64_t threshold = random() % 110000;
+            uint64_t sum = 0;
+            optional<uint64_t> smallest;
+            for (auto size: sizes) {
+                if (size <= threshold) {
+                    sum += size;
+                }
+                if (size >= threshold && (!smallest || size < *smallest)) {
+                    smallest = size;
+                }
+            }
+            ASSERT_EQ(random_index.sum_at_most(threshold), sum);
+            ASSERT_EQ(random_index.smallest_at_least(threshold), smallest);
+        }
+    }
+
+    TEST(Day7, Part1) {
+        ifstream input;
+        input.open("../../test/input/day7.txt");
 
-        auto used = aggregateSize["/"];
-        auto unused = 70000000 - used;
-        auto needed = 30000000;
-        auto neededToFree = needed - unused;
+        auto tree = parse_tree(input);
 
-        auto found = find_if(pairs.begin(), pairs.end(), [&](auto a) { return a.second >= neededToFree; });
-        if (found == pairs.end()) {
-            throw logic_error("not found");
-        }
+        cout << size_index(tree).sum_at_most(100000) << endl;
+    }
+
+    TEST(Day7, Part2) {
+        ifstream input;
+        input.open("../../test/input/day7.txt");
+
+        auto tree = parse_tree(input);
 
-        cout << found->second << endl;
+        cout << directory_to_delete(tree, size_index(tree)) << endl;
     }
 
-}
\ No newline at end of file
+}
@@ -1,5 +1,11 @@
 #include <gtest/gtest.h>
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <fstream>
+#include <random>
+#include <sstream>
+#include "simd.h"
 
 using namespace std;
 
@@ -45,10 +51,7 @@ namespace day8 {
         return visibleTrees;
     }
 
-    TEST(Day8, Part1) {
-        ifstream input;
-        input.open("../../test/input/day8.txt");
-
+    vector<vector<visibility>> parseRows(istream &input) {
         vector<vector<visibility>> rows;
 
         while (true) {
@@ -64,64 +67,458 @@ namespace day8 {
             }
             rows.push_back(std::move(row));
         }
+        return rows;
+    }
 
-        for (int r = 0; r < rows.size(); ++r) {
-            updateVisibility(rows, r, 0, 0, 1);
-            updateVisibility(rows, r, rows[0].size() - 1, 0, -1);
+    /**
+     * Tree heights in one row-major block of bytes.
+     */
+    struct forest {
+        int rows{0};
+        int cols{0};
+        vector<uint8_t> heights;
+
+        [[nodiscard]] uint8_t at(int r, int c) const { return heights[(size_t) r * cols + c]; }
+    };
+
+    forest parse_forest(istream &input) {
+        forest result;
+        string line;
+        while (getline(input, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty()) {
+                continue;
+            }
+            if (result.rows > 0 && line.size() != result.cols) {
+                throw logic_error("ragged forest");
+            }
+            result.cols = (int) line.size();
+            for (auto c: line) {
+                if (c < '0' || c > '9') {
+                    throw logic_error("invalid height");
+                }
+                result.heights.push_back(c - '0');
+            }
+            result.rows++;
         }
-        for (int c = 0; c < rows[0].size(); ++c) {
-            updateVisibility(rows, 0, c, 1, 0);
-            updateVisibility(rows, rows.size() - 1, c, -1, 0);
+        return result;
+    }
+
+    struct survey_result {
+        long visible;
+        long long best_scenic_score;
+    };
+
+    /**
+     * State for walking along one line of trees. blocker[h] is the last position so far with a tree at least
+     * h tall, so each tree is an O(1) lookup plus an update of at most 10 entries.
+     */
+    struct sight_line {
+        array<int, 10> blocker;
+
+        sight_line() { blocker.fill(-1); }
+
+        /**
+         * How far back towards the start of the line a tree of height h at position i can see, with
+         * visible_bit set if nothing blocks it all the way to the edge.
+         */
+        uint32_t look(int i, uint8_t h) {
+            auto b = blocker[h];
+            for (int k = 0; k <= h; ++k) {
+                blocker[k] = i;
+            }
+            return b < 0 ? (uint32_t) i | visible_bit : (uint32_t) (i - b);
+        }
+
+        static constexpr uint32_t visible_bit = 1u << 31;
+    };
+
+    /**
+     * Counts the trees visible from outside the forest and finds the best scenic score, in O(rows * cols).
+     *
+     * One pass goes down the rows. The upward, leftward and rightward distances are known as soon as a tree is
+     * reached, but the downward one isn't until a tree at least as tall turns up below it. Each column keeps
+     * those unfinished trees on a stack; their heights strictly decrease towards the top, so there are never
+     * more than 10 of them, and the scratch space is a row's worth of distances plus a few entries per column.
+     */
+    survey_result survey(const forest &trees) {
+        struct waiting_tree {
+            int row;
+            uint8_t height;
+            bool visible;
+            // product of the up, left and right viewing distances
+            long long partial_score;
+        };
+
+        struct column_state {
+            sight_line from_top;
+            array<waiting_tree, 10> waiting;
+            int waiting_count{0};
+        };
+
+        survey_result result{0, 0};
+        if (trees.rows == 0 || trees.cols == 0) {
+            return result;
+        }
+        const auto cols = (size_t) trees.cols;
+        const auto mask = ~sight_line::visible_bit;
+        auto finish = [&](const waiting_tree &tree, int down, bool visible_down) {
+            if (tree.visible || visible_down) {
+                result.visible++;
+            }
+            result.best_scenic_score = max(result.best_scenic_score, tree.partial_score * down);
+        };
+
+        vector<column_state> columns(cols);
+        vector<uint32_t> left(cols);
+        for (int r = 0; r < trees.rows; ++r) {
+            auto row = &trees.heights[r * cols];
+            sight_line from_left;
+            for (size_t c = 0; c < cols; ++c) {
+                left[c] = from_left.look((int) c, row[c]);
+            }
+            sight_line from_right;
+            for (auto c = (long) cols - 1; c >= 0; --c) {
+                auto right = from_right.look((int) (cols - 1 - c), row[c]);
+                auto &column = columns[c];
+                auto up = column.from_top.look(r, row[c]);
+                // this tree blocks the downward view of everything waiting above it that isn't taller
+                while (column.waiting_count > 0 && column.waiting[column.waiting_count - 1].height <= row[c]) {
+                    auto &above = column.waiting[--column.waiting_count];
+                    finish(above, r - above.row, false);
+                }
+                auto l = left[c];
+                column.waiting[column.waiting_count++] = {
+                        r, row[c], ((up | l | right) & sight_line::visible_bit) != 0,
+                        (long long) (up & mask) * (l & mask) * (right & mask)};
+            }
         }
 
-        int numVisible = 0;
+        // whatever is still waiting can see all the way to the bottom edge
+        for (auto &column: columns) {
+            for (int i = 0; i < column.waiting_count; ++i) {
+                finish(column.waiting[i], trees.rows - 1 - column.waiting[i].row, true);
+            }
+        }
+        return result;
+    }
 
-        for (const auto &item: rows) {
-            for (const auto &item: item) {
-                if (item.isVisible) {
-                    numVisible += 1;
+    /**
+     * dst = transpose of the rows x cols byte grid src. Works in square tiles so both the reads and the writes
+     * stay within a few cache lines at a time.
+     */
+    void transpose(const uint8_t *src, int rows, int cols, uint8_t *dst) {
+        const int tile = 64;
+        for (int r0 = 0; r0 < rows; r0 += tile) {
+            for (int c0 = 0; c0 < cols; c0 += tile) {
+                auto r1 = min(rows, r0 + tile);
+                auto c1 = min(cols, c0 + tile);
+                for (int r = r0; r < r1; ++r) {
+                    for (int c = c0; c < c1; ++c) {
+                        dst[(size_t) c * rows + r] = src[(size_t) r * cols + c];
+                    }
                 }
             }
         }
+    }
 
-        cout << numVisible << endl;
+#ifdef SIMD_X86
+    /**
+     * One row step of mark_visible_vertically for the columns from c on, 32 at a time, for as many whole groups
+     * of 32 as there are. Returns the first column it didn't do.
+     */
+    __attribute__((target("avx2")))
+    int mark_row_avx2(const uint8_t *row, int cols, int8_t *running, uint8_t *row_mask, int c) {
+        for (; c + 32 <= cols; c += 32) {
+            auto h = _mm256_loadu_si256((const __m256i *) (row + c));
+            auto highest = _mm256_loadu_si256((const __m256i *) (running + c));
+            auto visible = _mm256_cmpgt_epi8(h, highest);
+            auto m = _mm256_loadu_si256((const __m256i *) (row_mask + c));
+            _mm256_storeu_si256((__m256i *) (row_mask + c), _mm256_or_si256(m, visible));
+            _mm256_storeu_si256((__m256i *) (running + c), _mm256_max_epi8(h, highest));
+        }
+        return c;
     }
 
-    TEST(Day8, Part2) {
+    /**
+     * mark_row_avx2, 16 columns at a time.
+     */
+    __attribute__((target("sse2")))
+    int mark_row_sse2(const uint8_t *row, int cols, int8_t *running, uint8_t *row_mask, int c) {
+        for (; c + 16 <= cols; c += 16) {
+            auto h = _mm_loadu_si128((const __m128i *) (row + c));
+            auto highest = _mm_loadu_si128((const __m128i *) (running + c));
+            auto visible = _mm_cmpgt_epi8(h, highest);
+            auto m = _mm_loadu_si128((const __m128i *) (row_mask + c));
+            _mm_storeu_si128((__m128i *) (row_mask + c), _mm_or_si128(m, visible));
+            // SSE2 has no signed byte max, so select with the comparison that's already done
+            _mm_storeu_si128((__m128i *) (running + c),
+                             _mm_or_si128(_mm_and_si128(visible, h), _mm_andnot_si128(visible, highest)));
+        }
+        return c;
+    }
+
+    /**
+     * Number of zero bytes in the whole 32-byte blocks of [begin + i, begin + size). Advances i past them.
+     */
+    __attribute__((target("avx2")))
+    long count_zero_avx2(const uint8_t *begin, size_t size, size_t &i) {
+        long zeros = 0;
+        for (; i + 32 <= size; i += 32) {
+            auto zero = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (begin + i)), _mm256_setzero_si256());
+            zeros += __builtin_popcount((uint32_t) _mm256_movemask_epi8(zero));
+        }
+        return zeros;
+    }
+
+    /**
+     * count_zero_avx2, 16 bytes at a time.
+     */
+    __attribute__((target("sse2")))
+    long count_zero_sse2(const uint8_t *begin, size_t size, size_t &i) {
+        long zeros = 0;
+        for (; i + 16 <= size; i += 16) {
+            auto zero = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (begin + i)), _mm_setzero_si128());
+            zeros += __builtin_popcount((uint32_t) _mm_movemask_epi8(zero));
+        }
+        return zeros;
+    }
+#endif
+
+    /**
+     * Sets mask to 0xff for every tree visible from the top or bottom edge of the grid, and leaves the rest
+     * alone. Goes down (then up) the grid one row at a time keeping the running max height of every column, so
+     * each step compares and maxes 32 (AVX2) or 16 (SSE2) columns at once.
+     */
+    void mark_visible_vertically(const uint8_t *heights, int rows, int cols, uint8_t *mask,
+                                 simd_kernel kernel = best_kernel()) {
+        vector<int8_t> running(cols);
+        for (int pass = 0; pass < 2; ++pass) {
+            fill(running.begin(), running.end(), -1);
+            for (int i = 0; i < rows; ++i) {
+                auto r = pass == 0 ? i : rows - 1 - i;
+                auto row = heights + (size_t) r * cols;
+                auto row_mask = mask + (size_t) r * cols;
+                int c = 0;
+#ifdef SIMD_X86
+                if (kernel == simd_kernel::avx2) {
+                    c = mark_row_avx2(row, cols, running.data(), row_mask, c);
+                } else if (kernel != simd_kernel::scalar) {
+                    c = mark_row_sse2(row, cols, running.data(), row_mask, c);
+                }
+#endif
+                for (; c < cols; ++c) {
+                    if ((int8_t) row[c] > running[c]) {
+                        row_mask[c] = 0xff;
+                        running[c] = (int8_t) row[c];
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * Number of nonzero bytes in [begin, begin + size).
+     */
+    long count_nonzero(const uint8_t *begin, size_t size, simd_kernel kernel = best_kernel()) {
+        long result = 0;
+        size_t i = 0;
+#ifdef SIMD_X86
+        if (kernel == simd_kernel::avx2) {
+            result -= count_zero_avx2(begin, size, i);
+        } else if (kernel != simd_kernel::scalar) {
+            result -= count_zero_sse2(begin, size, i);
+        }
+        result += (long) i;
+#endif
+        for (; i < size; ++i) {
+            result += begin[i] != 0;
+        }
+        return result;
+    }
+
+    /**
+     * Part 1 with vector kernels: the top/bottom pass runs on the grid as is, the left/right pass runs on its
+     * transpose, and the two visibility masks are ORed (after transposing the second one back) and counted.
+     */
+    long count_visible(const forest &trees, simd_kernel kernel = best_kernel()) {
+        auto size = trees.heights.size();
+        vector<uint8_t> vertical(size);
+        mark_visible_vertically(trees.heights.data(), trees.rows, trees.cols, vertical.data(), kernel);
+
+        vector<uint8_t> transposed(size);
+        transpose(trees.heights.data(), trees.rows, trees.cols, transposed.data());
+        vector<uint8_t> horizontal_transposed(size);
+        mark_visible_vertically(transposed.data(), trees.cols, trees.rows, horizontal_transposed.data(), kernel);
+        // transposed is free again, so reuse it for the horizontal mask in row-major order
+        transpose(horizontal_transposed.data(), trees.cols, trees.rows, transposed.data());
+
+        for (size_t i = 0; i < size; ++i) {
+            vertical[i] |= transposed[i];
+        }
+        return count_nonzero(vertical.data(), size, kernel);
+    }
+
+    forest generate_forest(int rows, int cols, unsigned seed) {
+        mt19937 random(seed);
+        forest result{rows, cols, vector<uint8_t>((size_t) rows * cols)};
+        for (auto &h: result.heights) {
+            h = random() % 10;
+        }
+        return result;
+    }
+
+    TEST(Day8, survey) {
+        istringstream sample("30373\n25512\n65332\n33549\n35390\n");
+        auto result = survey(parse_forest(sample));
+        ASSERT_EQ(result.visible, 21);
+        ASSERT_EQ(result.best_scenic_score, 8);
+
+        for (unsigned seed = 1; seed <= 50; ++seed) {
+            auto trees = generate_forest(1 + (int) seed % 13, 1 + (int) seed % 17, seed);
+            vector<vector<visibility>> rows(trees.rows);
+            for (int r = 0; r < trees.rows; ++r) {
+                for (int c = 0; c < trees.cols; ++c) {
+                    rows[r].push_back({trees.at(r, c), false});
+                }
+            }
+            for (int r = 0; r < rows.size(); ++r) {
+                updateVisibility(rows, r, 0, 0, 1);
+                updateVisibility(rows, r, rows[0].size() - 1, 0, -1);
+            }
+            for (int c = 0; c < rows[0].size(); ++c) {
+                updateVisibility(rows, 0, c, 1, 0);
+                updateVisibility(rows, rows.size() - 1, c, -1, 0);
+            }
+            long visible = 0;
+            long long best = 0;
+            for (int r = 0; r < rows.size(); ++r) {
+                for (int c = 0; c < rows[0].size(); ++c) {
+                    visible += rows[r][c].isVisible;
+                    best = max(best, (long long) countVisibleTrees(rows, r, c, 0, 1) *
+                                     countVisibleTrees(rows, r, c, 0, -1) *
+                                     countVisibleTrees(rows, r, c, 1, 0) *
+                                     countVisibleTrees(rows, r, c, -1, 0));
+                }
+            }
+            result = survey(trees);
+            ASSERT_EQ(result.visible, visible);
+            ASSERT_EQ(result.best_scenic_score, best);
+        }
+
         ifstream input;
         input.open("../../test/input/day8.txt");
+        auto rows = parseRows(input);
+        input.clear();
+        input.seekg(0);
+        result = survey(parse_forest(input));
+        long long best = 0;
+        for (int r = 0; r < rows.size(); ++r) {
+            for (int c = 0; c < rows[0].size(); ++c) {
+                best = max(best, (long long) countVisibleTrees(rows, r, c, 0, 1) *
+                                 countVisibleTrees(rows, r, c, 0, -1) *
+                                 countVisibleTrees(rows, r, c, 1, 0) *
+                                 countVisibleTrees(rows, r, c, -1, 0));
+            }
+        }
+        ASSERT_EQ(result.best_scenic_score, best);
+    }
 
-        vector<vector<visibility>> rows;
+    TEST(Day8, DISABLED_survey_large) {
+        auto trees = generate_forest(2000, 2000, 1);
+        auto p_as_float = (double) chrono::steady_clock::period::num / (double) chrono::steady_clock::period::den;
+        auto start = chrono::steady_clock::now();
+        auto result = survey(trees);
+        auto end = chrono::steady_clock::now();
+        cout << "2000x2000 visible: " << result.visible << ", best: " << result.best_scenic_score
+             << ", seconds: " << ((end - start).count() * p_as_float) << endl;
+    }
 
-        while (true) {
-            string line;
-            getline(input, line);
-            if (!input) {
-                break;
+    TEST(Day8, count_visible) {
+        istringstream sample("30373\n25512\n65332\n33549\n35390\n");
+        ASSERT_EQ(count_visible(parse_forest(sample)), 21);
+
+        for (unsigned seed = 1; seed <= 50; ++seed) {
+            auto trees = generate_forest(1 + (int) seed * 7 % 97, 1 + (int) seed * 13 % 101, seed);
+            auto expected = survey(trees).visible;
+            for (auto kernel: supported_kernels()) {
+                ASSERT_EQ(count_visible(trees, kernel), expected);
             }
+        }
 
-            vector<visibility> row;
-            for (const auto &item: line) {
-                row.push_back({item - '0', false});
+        mt19937 random(1);
+        for (size_t size: {0, 1, 15, 16, 17, 31, 32, 33, 1000}) {
+            vector<uint8_t> bytes(size);
+            long nonzero = 0;
+            for (auto &b: bytes) {
+                b = random() % 3 == 0 ? 0 : random() % 256;
+                nonzero += b != 0;
+            }
+            for (auto kernel: supported_kernels()) {
+                ASSERT_EQ(count_nonzero(bytes.data(), size, kernel), nonzero);
             }
-            rows.push_back(std::move(row));
         }
+    }
+
+    TEST(Day8, DISABLED_count_visible_benchmark) {
+        auto trees = generate_forest(2000, 2000, 2);
+        const int iterations = 5;
+        auto p_as_float = (double) chrono::steady_clock::period::num / (double) chrono::steady_clock::period::den;
 
-        int bestScore = 0;
+        vector<vector<visibility>> rows(trees.rows);
+        for (int r = 0; r < trees.rows; ++r) {
+            for (int c = 0; c < trees.cols; ++c) {
+                rows[r].push_back({trees.at(r, c), false});
+            }
+        }
+        auto start = chrono::steady_clock::now();
         for (int r = 0; r < rows.size(); ++r) {
-            for (int c = 0; c < rows[0].size(); ++c) {
-                auto trees0 = countVisibleTrees(rows, r, c, 0, 1);
-                auto trees1 = countVisibleTrees(rows, r, c, 0, -1);
-                auto trees2 = countVisibleTrees(rows, r, c, 1, 0);
-                auto trees3 = countVisibleTrees(rows, r, c, -1, 0);
-                auto score = trees0 * trees1 * trees2 * trees3;
-                if (score > bestScore) {
-                    bestScore = score;
-                }
+            updateVisibility(rows, r, 0, 0, 1);
+            updateVisibility(rows, r, rows[0].size() - 1, 0, -1);
+        }
+        for (int c = 0; c < rows[0].size(); ++c) {
+            updateVisibility(rows, 0, c, 1, 0);
+            updateVisibility(rows, rows.size() - 1, c, -1, 0);
+        }
+        long scalar = 0;
+        for (const auto &row: rows) {
+            for (const auto &item: row) {
+                scalar += item.isVisible;
+            }
+        }
+        auto end = chrono::steady_clock::now();
+        cout << "updateVisibility seconds: " << ((end - start).count() * p_as_float) << endl;
+
+        const char *names[] = {"scalar", "sse2", "ssse3", "avx2"};
+        for (auto kernel: supported_kernels()) {
+            long vectorized = 0;
+            start = chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                vectorized = count_visible(trees, kernel);
             }
+            end = chrono::steady_clock::now();
+            cout << names[(int) kernel] << " count_visible seconds: "
+                 << ((end - start).count() * p_as_float / iterations) << endl;
+            ASSERT_EQ(vectorized, scalar);
         }
+    }
+
+    TEST(Day8, Part1) {
+        ifstream input;
+        input.open("../../test/input/day8.txt");
+
+        cout << count_visible(parse_forest(input)) << endl;
+    }
+
+    TEST(Day8, Part2) {
+        ifstream input;
+        input.open("../../test/input/day8.txt");
+
+        auto result = survey(parse_forest(input));
 
-        cout << bestScore << endl;
+        cout << result.best_scenic_score << endl;
     }
 
-}
\ No newline at end of file
+}
@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
+#include <chrono>
 #include <fstream>
+#include <random>
 #include <regex>
+#include <sstream>
+#include "pos2.h"
 
 using namespace std;
 
@@ -62,6 +66,254 @@ namespace day9 {
         return new_tail_pos;
     }
 
+    enum class direction {
+        up,
+        right,
+        down,
+        left
+    };
+
+    direction to_direction(char c) {
+        switch (c) {
+            case 'U':
+                return direction::up;
+            case 'R':
+                return direction::right;
+            case 'D':
+                return direction::down;
+            case 'L':
+                return direction::left;
+            default:
+                throw logic_error("invalid direction");
+        }
+    }
+
+    constexpr point direction_offsets[] = {{0, 1}, {1, 0}, {0, -1}, {-1, 0}};
+
+    struct command {
+        direction dir;
+        int distance;
+    };
+
+    vector<command> parse_commands(istream &input) {
+        vector<command> commands;
+        string line;
+        while (getline(input, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty()) {
+                continue;
+            }
+            if (line.size() < 3 || line[1] != ' ') {
+                throw logic_error("didn't match");
+            }
+            commands.push_back({to_direction(line[0]), stoi(line.substr(2))});
+        }
+        return commands;
+    }
+
+    /**
+     * A rope of any number of knots (at least one) that records every cell its last knot visits.
+     *
+     * Knots are updated from the head back, and as soon as one doesn't move none of the ones behind it can
+     * either, so the update stops there. That makes long ropes cheap, since most steps only disturb the first
+     * few knots.
+     */
+    class rope {
+    private:
+        vector<point> knots;
+        bitmap2 visited;
+
+    public:
+        explicit rope(size_t knot_count) : knots(knot_count) {
+            if (knot_count == 0) {
+                throw logic_error("a rope needs at least one knot");
+            }
+            visited.insert({0, 0});
+        }
+
+        void move(direction dir, int distance) {
+            auto offset = direction_offsets[(int) dir];
+            for (int i = 0; i < distance; ++i) {
+                knots[0] = point{knots[0].x + offset.x, knots[0].y + offset.y};
+                size_t j = 1;
+                for (; j < knots.size(); ++j) {
+                    auto next = update_tail(knots[j - 1], knots[j]);
+                    if (next == knots[j]) {
+                        break;
+                    }
+                    knots[j] = next;
+                }
+                if (j == knots.size()) {
+                    visited.insert({knots.back().x, knots.back().y});
+                }
+            }
+        }
+
+        void run(const vector<command> &commands) {
+            for (auto &c: commands) {
+                move(c.dir, c.distance);
+            }
+        }
+
+        [[nodiscard]] const vector<point> &positions() const { return knots; }
+
+        /**
+         * Number of distinct cells the last knot has been in, including the start.
+         */
+        [[nodiscard]] size_t tail_visited() const { return visited.size(); }
+    };
+
+    /**
+     * Like rope, but records the cells visited by every knot behind the head. Knot k only follows knot k - 1,
+     * so the first k knots move exactly like a rope of k knots would on its own, and one simulation answers
+     * tail_visited() for every rope length from 2 up to knot_count. Each knot has its own bitmap to fill in, so
+     * this is only worth it when more than one length is wanted.
+     */
+    class multi_rope {
+    private:
+        vector<point> knots;
+        // visited[k - 1] = cells knot k has been in; the head isn't tracked
+        vector<bitmap2> visited;
+
+    public:
+        explicit multi_rope(size_t knot_count) : knots(knot_count), visited(knot_count < 2 ? 0 : knot_count - 1) {
+            if (knot_count < 2) {
+                throw logic_error("a multi_rope needs at least two knots");
+            }
+            for (auto &v: visited) {
+                v.insert({0, 0});
+            }
+        }
+
+        void move(direction dir, int distance) {
+            auto offset = direction_offsets[(int) dir];
+            for (int i = 0; i < distance; ++i) {
+                knots[0] = point{knots[0].x + offset.x, knots[0].y + offset.y};
+                for (size_t j = 1; j < knots.size(); ++j) {
+                    auto next = update_tail(knots[j - 1], knots[j]);
+                    if (next == knots[j]) {
+                        break;
+                    }
+                    knots[j] = next;
+                    visited[j - 1].insert({next.x, next.y});
+                }
+            }
+        }
+
+        void run(const vector<command> &commands) {
+            for (auto &c: commands) {
+                move(c.dir, c.distance);
+            }
+        }
+
+        /**
+         * Number of distinct cells the last knot of a rope with the given number of knots would have been in,
+         * including the start. length can be anything from 2 to the number of knots in this rope.
+         */
+        [[nodiscard]] size_t tail_visited(size_t length) const { return visited.at(length - 2).size(); }
+
+        /**
+         * tail_visited(length) for every length from 2 up, at index length - 2.
+         */
+        [[nodiscard]] vector<size_t> tail_visited_by_length() const {
+            vector<size_t> result;
+            for (auto &v: visited) {
+                result.push_back(v.size());
+            }
+            return result;
+        }
+    };
+
+    /**
+     * Random commands that wander around without drifting too far from the start.
+     */
+    vector<command> generate_commands(size_t count, int max_distance, unsigned seed) {
+        mt19937 random(seed);
+        vector<command> commands;
+        for (size_t i = 0; i < count; ++i) {
+            commands.push_back({direction(random() % 4), 1 + (int) (random() % max_distance)});
+        }
+        return commands;
+    }
+
+    /**
+     * The original simulation, with a set of tail positions and string directions, as a reference.
+     */
+    size_t tail_visited_with_set(const vector<command> &commands, size_t knot_count) {
+        const string names[] = {"U", "R", "D", "L"};
+        vector<point> knotPositions(knot_count);
+        set<point> tailPositions;
+        tailPositions.insert(point{});
+        for (auto &c: commands) {
+            for (auto i = 0; i < c.distance; ++i) {
+                knotPositions[0] = update_head(knotPositions[0], names[(int) c.dir]);
+                for (auto j = 1; j < knotPositions.size(); ++j) {
+                    knotPositions[j] = update_tail(knotPositions[j - 1], knotPositions[j]);
+                }
+                tailPositions.insert(knotPositions.back());
+            }
+        }
+        return tailPositions.size();
+    }
+
+    TEST(Day9, rope) {
+        istringstream sample("R 4\nU 4\nL 3\nD 1\nR 4\nD 1\nL 5\nR 2\n");
+        auto commands = parse_commands(sample);
+        rope short_rope(2);
+        short_rope.run(commands);
+        ASSERT_EQ(short_rope.tail_visited(), 13);
+
+        istringstream larger("R 5\nU 8\nL 8\nD 3\nR 17\nD 10\nL 25\nU 20\n");
+        rope long_rope(10);
+        long_rope.run(parse_commands(larger));
+        ASSERT_EQ(long_rope.tail_visited(), 36);
+
+        for (unsigned seed = 1; seed <= 20; ++seed) {
+            auto generated = generate_commands(200, 1 + (int) seed, seed);
+            for (size_t knots: {1, 2, 3, 10, 25}) {
+                rope r(knots);
+                r.run(generated);
+                ASSERT_EQ(r.tail_visited(), tail_visited_with_set(generated, knots));
+            }
+        }
+    }
+
+    TEST(Day9, tail_visited_by_length) {
+        istringstream larger("R 5\nU 8\nL 8\nD 3\nR 17\nD 10\nL 25\nU 20\n");
+        multi_rope sample_rope(10);
+        sample_rope.run(parse_commands(larger));
+        ASSERT_EQ(sample_rope.tail_visited(10), 36);
+
+        for (unsigned seed = 1; seed <= 10; ++seed) {
+            auto generated = generate_commands(300, 1 + (int) seed, seed);
+            multi_rope all(12);
+            all.run(generated);
+            auto by_length = all.tail_visited_by_length();
+            ASSERT_EQ(by_length.size(), 11);
+            for (size_t length = 2; length <= 12; ++length) {
+                rope single(length);
+                single.run(generated);
+                ASSERT_EQ(by_length[length - 2], single.tail_visited());
+                ASSERT_EQ(all.tail_visited(length), single.tail_visited());
+            }
+        }
+    }
+
+    TEST(Day9, DISABLED_rope_benchmark) {
+        auto commands = generate_commands(300000, 10, 1);
+        auto p_as_float = (double) chrono::steady_clock::period::num / (double) chrono::steady_clock::period::den;
+        for (size_t knots: {2, 10, 100}) {
+            rope r(knots);
+            auto start = chrono::steady_clock::now();
+            r.run(commands);
+            auto end = chrono::steady_clock::now();
+            cout << knots << " knots, 300000 commands, visited: " << r.tail_visited() << ", seconds: "
+                 << ((end - start).count() * p_as_float) << endl;
+        }
+    }
+
     TEST(Day9, update_tail) {
         EXPECT_EQ(update_tail(point{1, 0}, point{0, 0}), (point{0, 0}));
         EXPECT_EQ(update_tail(point{1, 1}, point{0, 0}), (point{0, 0}));
@@ -86,95 +338,35 @@ namespace day9 {
         EXPECT_EQ(update_tail(point{-2, -2}, point{0, 0}), (point{-1, -1}));
     }
 
-    TEST(Day9, Part1) {
+    TEST(Day9, both_parts) {
         ifstream input;
         input.open("../../test/input/day9.txt");
-//    stringstream input("R 4\n"
-//                       "U 4\n"
-//                       "L 3\n"
-//                       "D 1\n"
-//                       "R 4\n"
-//                       "D 1\n"
-//                       "L 5\n"
-//                       "R 2");
-
-        point head_pos{};
-        point tail_pos{};
-        set<point> tailPositions;
-        tailPositions.insert(point{});
 
-        while (true) {
-            string line;
-            getline(input, line);
-            if (!input) {
-                break;
-            }
+        multi_rope r(10);
+        r.run(parse_commands(input));
 
-            smatch result;
-            if (!regex_match(line, result, line_regex)) {
-                throw logic_error("didn't match");
-            }
-            auto dir = result[1].str();
-            auto dist = stoi(result[2].str());
+        cout << r.tail_visited(2) << endl;
+        cout << r.tail_visited(10) << endl;
+    }
 
-            for (auto i = 0; i < dist; ++i) {
-                head_pos = update_head(head_pos, dir);
-                tail_pos = update_tail(head_pos, tail_pos);
-                tailPositions.insert(tail_pos);
-            }
-        }
+    TEST(Day9, Part1) {
+        ifstream input;
+        input.open("../../test/input/day9.txt");
+
+        rope r(2);
+        r.run(parse_commands(input));
 
-        cout << tailPositions.size() << endl;
+        cout << r.tail_visited() << endl;
     }
 
     TEST(Day9, Part2) {
         ifstream input;
         input.open("../../test/input/day9.txt");
-//    stringstream input("R 4\n"
-//                       "U 4\n"
-//                       "L 3\n"
-//                       "D 1\n"
-//                       "R 4\n"
-//                       "D 1\n"
-//                       "L 5\n"
-//                       "R 2");
-//    stringstream input("R 5\n"
-//                       "U 8\n"
-//                       "L 8\n"
-//                       "D 3\n"
-//                       "R 17\n"
-//                       "D 10\n"
-//                       "L 25\n"
-//                       "U 20");
-
-        vector<point> knotPositions(10);
-        set<point> tailPositions;
-        tailPositions.insert(point{});
-
-        while (true) {
-            string line;
-            getline(input, line);
-            if (!input) {
-                break;
-            }
-
-            smatch result;
-            if (!regex_match(line, result, line_regex)) {
-                throw logic_error("didn't match");
-            }
-            auto dir = result[1].str();
-            auto dist = stoi(result[2].str());
 
-            for (auto i = 0; i < dist; ++i) {
-                knotPositions[0] = update_head(knotPositions[0], dir);
-                for (auto j = 1; j < knotPositions.size(); ++j) {
-                    knotPositions[j] = update_tail(knotPositions[j - 1], knotPositions[j]);
-                }
-                tailPositions.insert(knotPositions.back());
-            }
-        }
+        rope r(10);
+        r.run(parse_commands(input));
 
-        cout << tailPositions.size() << endl;
+        cout << r.tail_visited() << endl;
     }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "position.h"
+#include "span_list.h"
+
+/**
+ * The set of cells within a given manhattan distance of a center cell.
+ */
+struct diamond {
+    position center;
+    int radius;
+
+    [[nodiscard]] int top() const { return center.y - radius; }
+
+    [[nodiscard]] int bottom() const { return center.y + radius; }
+
+    /**
+     * Number of cells to either side of the center column that are covered on row y.
+     * Negative if the row doesn't intersect the diamond.
+     */
+    [[nodiscard]] int half_width_at(int y) const { return radius - abs(center.y - y); }
+
+    [[nodiscard]] bool contains(const position &p) const {
+        return center.manhattan_distance_to(p) <= radius;
+    }
+};
+
+/**
+ * Answers coverage questions about a union of diamonds one row at a time.
+ *
+ * Rows are visited in order and only the diamonds that intersect the current row are kept active, so
+ * memory is O(diamonds) no matter how tall the search area is. When a row turns out to be fully covered,
+ * the sweep works out how many of the following rows must also be fully covered and jumps past them.
+ */
+class diamond_sweep {
+private:
+    /**
+     * A diamond's span on one row, along with how its ends move on the rows below it. Up to the center row
+     * the span grows by one column on each side per row, after that it shrinks; either way the motion is
+     * linear until the row given by next_event.
+     */
+    struct active_span {
+        span s;
+        int growth;
+        int next_event;
+    };
+
+    std::vector<diamond> by_top;
+
+    std::optional<position> find_uncovered_in_band(int xmin, int xmax, int ymin, int ymax) const {
+        std::vector<diamond> active;
+        std::vector<active_span> row;
+        auto next = by_top.begin();
+
+        for (int y = ymin; y <= ymax;) {
+            for (; next != by_top.end() && next->top() <= y; ++next) {
+                active.push_back(*next);
+            }
+            active.erase(
+                    std::remove_if(active.begin(), active.end(), [&](const auto &d) { return d.bottom() < y; }),
+                    active.end());
+
+            row.clear();
+            for (const auto &d: active) {
+                auto hw = d.half_width_at(y);
+                auto growing = y < d.center.y;
+                row.push_back({
+                        {d.center.x - hw, d.center.x + hw},
+                        growing ? 1 : -1,
+                        growing ? d.center.y : d.bottom()});
+            }
+            std::sort(row.begin(), row.end(), [](const auto &a, const auto &b) { return a.s.first() < b.s.first(); });
+
+            // Greedily pick the chain of spans that covers [xmin, xmax]. Until the next event of any span in
+            // the chain, every link's overlap changes linearly, so we can tell exactly how many of the following
+            // rows the same chain keeps covering.
+            int skip = ymax - y;
+            int cur = xmin;
+            const active_span *prev = nullptr;
+            auto iter = row.begin();
+            while (cur <= xmax) {
+                const active_span *best = nullptr;
+                for (; iter != row.end() && iter->s.first() <= cur; ++iter) {
+                    if (best == nullptr || iter->s.last() > best->s.last()) {
+                        best = &*iter;
+                    }
+                }
+                if (best == nullptr || best->s.last() < cur) {
+                    return position{cur, y};
+                }
+
+                if (prev == nullptr) {
+                    if (best->growth < 0) {
+                        skip = std::min(skip, xmin - best->s.first());
+                    }
+                } else if (prev->growth + best->growth < 0) {
+                    skip = std::min(skip, (prev->s.last() - best->s.first() + 1) / 2);
+                }
+                skip = std::min(skip, best->next_event - y);
+
+                cur = best->s.last() + 1;
+                prev = best;
+            }
+            if (prev->growth < 0) {
+                skip = std::min(skip, prev->s.last() - xmax);
+            }
+
+            y += skip + 1;
+        }
+
+        return std::nullopt;
+    }
+
+public:
+    explicit diamond_sweep(std::vector<diamond> diamonds) : by_top(std::move(diamonds)) {
+        std::sort(by_top.begin(), by_top.end(), [](const auto &a, const auto &b) { return a.top() < b.top(); });
+    }
+
+    /**
+     * All covered cells on row y.
+     */
+    [[nodiscard]] span_list row_coverage(int y) const {
+        span_list result;
+        for (const auto &d: by_top) {
+            auto hw = d.half_width_at(y);
+            if (hw >= 0) {
+                result.insert_range(d.center.x - hw, d.center.x + hw);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Finds the uncovered cell within the inclusive box [min, max] with the smallest y (and then smallest x).
+     */
+    [[nodiscard]] std::optional<position> find_uncovered(const position &min, const position &max) const {
+        return find_uncovered_in_band(min.x, max.x, min.y, max.y);
+    }
+
+    /**
+     * Same as find_uncovered, but splits the box into horizontal bands that are swept on separate threads.
+     */
+    [[nodiscard]] std::optional<position> find_uncovered_parallel(
+            const position &min, const position &max, unsigned num_bands) const {
+        num_bands = std::max(1u, num_bands);
+        long long height = (long long) max.y - min.y + 1;
+        if (height <= 0) {
+            return std::nullopt;
+        }
+        num_bands = (unsigned) std::min<long long>(num_bands, height);
+
+        std::vector<std::optional<position>> results(num_bands);
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < num_bands; ++i) {
+            int band_min = (int) (min.y + height * i / num_bands);
+            int band_max = (int) (min.y + height * (i + 1) / num_bands - 1);
+            threads.emplace_back([&, i, band_min, band_max]() {
+                results[i] = find_uncovered_in_band(min.x, max.x, band_min, band_max);
+            });
+        }
+        for (auto &t: threads) {
+            t.join();
+        }
+
+        for (const auto &r: results) {
+            if (r) {
+                return r;
+            }
+        }
+        return std::nullopt;
+    }
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+#include "diamond.h"
+#include "position.h"
+#include "span_list.h"
+
+/**
+ * Rotated coordinates: u = x + y, v = x - y. A cell (x, y) maps to a (u, v) with u and v of the same parity,
+ * and a diamond maps to an axis-aligned square.
+ */
+struct rotated_pos {
+    int u;
+    int v;
+
+    static rotated_pos from_position(const position &p) {
+        return {p.x + p.y, p.x - p.y};
+    }
+
+    [[nodiscard]] bool is_cell() const {
+        return ((u ^ v) & 1) == 0;
+    }
+
+    [[nodiscard]] position to_position() const {
+        return {(u + v) / 2, (u - v) / 2};
+    }
+};
+
+/**
+ * Inclusive axis-aligned rectangle in rotated coordinates.
+ */
+struct rotated_rect {
+    int umin;
+    int umax;
+    int vmin;
+    int vmax;
+
+    static rotated_rect from_diamond(const diamond &d) {
+        auto c = rotated_pos::from_position(d.center);
+        return {c.u - d.radius, c.u + d.radius, c.v - d.radius, c.v + d.radius};
+    }
+
+    [[nodiscard]] bool contains(const rotated_pos &p) const {
+        return p.u >= umin && p.u <= umax && p.v >= vmin && p.v <= vmax;
+    }
+};
+
+/**
+ * Union of diamonds, queried in rotated coordinates.
+ *
+ * Where diamond_sweep has to walk down the rows, this only looks at the lines just outside each square. Take
+ * the uncovered cell with the smallest u (then smallest v) in a box. Its neighbors at (x - 1, y) and (x, y - 1)
+ * are either outside the box or covered, and if they're covered then the cell sits just past the edge of some
+ * square in either u or v. So scanning those O(n) lines, plus the top and left edges of the box, finds it in
+ * O(n^2 log n) regardless of how big the box is.
+ */
+class diamond_union {
+private:
+    std::vector<diamond> diamonds;
+    std::vector<rotated_rect> rects;
+
+    /**
+     * First of lo, lo + step, lo + 2 * step, ... up to hi that isn't in covered.
+     */
+    static std::optional<int> first_gap(const span_list &covered, int lo, int hi, int step) {
+        int candidate = lo;
+        for (const auto &s: covered) {
+            if (candidate > hi || candidate < s.first()) {
+                break;
+            }
+            if (candidate <= s.last()) {
+                candidate += (s.last() - candidate + step) / step * step;
+            }
+        }
+        if (candidate <= hi) {
+            return candidate;
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * Rounds lo up so it has the same parity as other, since only those (u, v) pairs are cells.
+     */
+    static int align_parity(int lo, int other) {
+        return ((lo ^ other) & 1) == 0 ? lo : lo + 1;
+    }
+
+    std::optional<position> uncovered_on_u(int u, const position &min, const position &max) const {
+        int lo = std::max(2 * min.x - u, u - 2 * max.y);
+        int hi = std::min(2 * max.x - u, u - 2 * min.y);
+        if (lo > hi) {
+            return std::nullopt;
+        }
+        span_list covered;
+        for (const auto &r: rects) {
+            if (r.umin <= u && u <= r.umax) {
+                covered.insert_range(r.vmin, r.vmax);
+            }
+        }
+        if (auto v = first_gap(covered, align_parity(lo, u), hi, 2)) {
+            return rotated_pos{u, *v}.to_position();
+        }
+        return std::nullopt;
+    }
+
+    std::optional<position> uncovered_on_v(int v, const position &min, const position &max) const {
+        int lo = std::max(2 * min.x - v, 2 * min.y + v);
+        int hi = std::min(2 * max.x - v, 2 * max.y + v);
+        if (lo > hi) {
+            return std::nullopt;
+        }
+        span_list covered;
+        for (const auto &r: rects) {
+            if (r.vmin <= v && v <= r.vmax) {
+                covered.insert_range(r.umin, r.umax);
+            }
+        }
+        if (auto u = first_gap(covered, align_parity(lo, v), hi, 2)) {
+            return rotated_pos{*u, v}.to_position();
+        }
+        return std::nullopt;
+    }
+
+    std::optional<position> uncovered_on_row(int y, int xmin, int xmax) const {
+        span_list covered;
+        for (const auto &d: diamonds) {
+            auto hw = d.half_width_at(y);
+            if (hw >= 0) {
+                covered.insert_range(d.center.x - hw, d.center.x + hw);
+            }
+        }
+        if (auto x = first_gap(covered, xmin, xmax, 1)) {
+            return position{*x, y};
+        }
+        return std::nullopt;
+    }
+
+    std::optional<position> uncovered_on_column(int x, int ymin, int ymax) const {
+        span_list covered;
+        for (const auto &d: diamonds) {
+            auto hh = d.radius - abs(d.center.x - x);
+            if (hh >= 0) {
+                covered.insert_range(d.center.y - hh, d.center.y + hh);
+            }
+        }
+        if (auto y = first_gap(covered, ymin, ymax, 1)) {
+            return position{x, *y};
+        }
+        return std::nullopt;
+    }
+
+public:
+    explicit diamond_union(std::vector<diamond> diamonds) : diamonds(std::move(diamonds)) {
+        for (const auto &d: this->diamonds) {
+            rects.push_back(rotated_rect::from_diamond(d));
+        }
+    }
+
+    [[nodiscard]] const std::vector<rotated_rect> &squares() const {
+        return rects;
+    }
+
+    [[nodiscard]] bool contains(const position &p) const {
+        auto rp = rotated_pos::from_position(p);
+        return std::any_of(rects.begin(), rects.end(), [&](const auto &r) { return r.contains(rp); });
+    }
+
+    /**
+     * Finds some cell within the inclusive box [min, max] that no diamond covers. Unlike
+     * diamond_sweep::find_uncovered, there's no guarantee about which one is returned if there are several.
+     */
+    [[nodiscard]] std::optional<position> find_uncovered(const position &min, const position &max) const {
+        if (min.x > max.x || min.y > max.y) {
+            return std::nullopt;
+        }
+        if (auto p = uncovered_on_row(min.y, min.x, max.x)) {
+            return p;
+        }
+        if (auto p = uncovered_on_column(min.x, min.y, max.y)) {
+            return p;
+        }
+        for (const auto &r: rects) {
+            if (auto p = uncovered_on_u(r.umax + 1, min, max)) {
+                return p;
+            }
+            if (auto p = uncovered_on_v(r.vmin - 1, min, max)) {
+                return p;
+            }
+            if (auto p = uncovered_on_v(r.vmax + 1, min, max)) {
+                return p;
+            }
+        }
+        return std::nullopt;
+    }
+};
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include "pos2.h"
+
+using namespace std;
+
+TEST(grid2, set_and_get) {
+    grid2<char> g('.');
+    ASSERT_TRUE(g.empty());
+
+    g.set({3, 4}, '#');
+    g.set({-10, 2}, '#');
+    g.set({5, -7}, 'x');
+
+    ASSERT_FALSE(g.empty());
+    ASSERT_EQ(g.bounds(), (pair<pos2, pos2>{{-10, -7}, {5, 4}}));
+    ASSERT_EQ(g.get({3, 4}), '#');
+    ASSERT_EQ(g.get({-10, 2}), '#');
+    ASSERT_EQ(g.get({5, -7}), 'x');
+    ASSERT_EQ(g.get({0, 0}), '.');
+    ASSERT_EQ(g.get({1000, 1000}), '.');
+}
+
+TEST(grid2, padding) {
+    grid2<int> g(0, 2);
+    g.set({0, 0}, 1);
+    g.set({1, 1}, 2);
+
+    for (int y = -2; y <= 3; ++y) {
+        for (int x = -2; x <= 3; ++x) {
+            pos2 p{x, y};
+            ASSERT_EQ(g[p], g.get(p));
+        }
+    }
+}
+
+TEST(grid2, rows) {
+    grid2<char> g('.');
+    g.set({2, 0}, 'a');
+    g.set({4, 0}, 'b');
+    g.set({3, 1}, 'c');
+
+    ASSERT_EQ(string(g.row_begin(0), g.row_end(0)), "a.b");
+    ASSERT_EQ(string(g.row_begin(1), g.row_end(1)), ".c.");
+}
+
+TEST(bitmap2, insert_and_contains) {
+    bitmap2 b;
+    ASSERT_TRUE(b.empty());
+    ASSERT_FALSE(b.contains({0, 0}));
+
+    mt19937 random(1);
+    uniform_int_distribution<int> coordinate(-300, 300);
+    set<pos2> expected;
+    for (int i = 0; i < 5000; ++i) {
+        pos2 p{coordinate(random), coordinate(random) / 4};
+        ASSERT_EQ(b.insert(p), expected.insert(p).second);
+    }
+    ASSERT_EQ(b.size(), expected.size());
+    for (int y = -80; y <= 80; ++y) {
+        for (int x = -310; x <= 310; ++x) {
+            ASSERT_EQ(b.contains({x, y}), expected.count({x, y}) > 0);
+        }
+    }
+
+    b.clear();
+    ASSERT_TRUE(b.empty());
+    ASSERT_FALSE(b.contains(*expected.begin()));
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * Answers counting queries over a fixed set of inclusive integer intervals without rescanning them: how many
+ * intervals contain a point, and how many lie entirely within a range.
+ *
+ * When the intervals span at most dense_limit values, both queries are single lookups into prefix-sum tables
+ * (a difference array for containment of a point, a 2D dominance table for containment in a range). Larger
+ * coordinates fall back to a centered interval tree for point queries and a merge sort tree for range queries,
+ * both O(log^2 n).
+ */
+class interval_index {
+public:
+    typedef std::pair<int, int> interval;
+
+    static constexpr int default_dense_limit = 512;
+
+private:
+    struct tree_node {
+        int center;
+        // Starts and ends of the intervals that contain center, each sorted
+        std::vector<int> starts;
+        std::vector<int> ends;
+        std::unique_ptr<tree_node> left;
+        std::unique_ptr<tree_node> right;
+    };
+
+    size_t _size{0};
+    bool dense{true};
+
+    // Dense mode: values are offset by lo, width = hi - lo + 1
+    int lo{0};
+    int width{0};
+    std::vector<int> covering;
+    // within[(a - lo) * width + (b - lo)] = number of intervals with start >= a and end <= b
+    std::vector<int> within;
+
+    // Sparse mode
+    std::unique_ptr<tree_node> root;
+    std::vector<int> sorted_starts;
+    // Bottom-up segment tree over the intervals in start order; each node holds its intervals' ends, sorted
+    std::vector<std::vector<int>> ends_tree;
+
+    static std::unique_ptr<tree_node> build_tree(std::vector<interval> intervals) {
+        if (intervals.empty()) {
+            return nullptr;
+        }
+        std::vector<int> endpoints;
+        for (auto &i: intervals) {
+            endpoints.push_back(i.first);
+            endpoints.push_back(i.second);
+        }
+        auto middle = endpoints.begin() + endpoints.size() / 2;
+        std::nth_element(endpoints.begin(), middle, endpoints.end());
+
+        auto node = std::make_unique<tree_node>();
+        node->center = *middle;
+        std::vector<interval> left;
+        std::vector<interval> right;
+        for (auto &i: intervals) {
+            if (i.second < node->center) {
+                left.push_back(i);
+            } else if (i.first > node->center) {
+                right.push_back(i);
+            } else {
+                node->starts.push_back(i.first);
+                node->ends.push_back(i.second);
+            }
+        }
+        std::sort(node->starts.begin(), node->starts.end());
+        std::sort(node->ends.begin(), node->ends.end());
+        intervals.clear();
+        intervals.shrink_to_fit();
+        node->left = build_tree(std::move(left));
+        node->right = build_tree(std::move(right));
+        return node;
+    }
+
+    void build_dense(const std::vector<interval> &intervals) {
+        covering.assign(width + 1, 0);
+        within.assign((size_t) width * width, 0);
+        for (auto &i: intervals) {
+            covering[i.first - lo]++;
+            covering[i.second - lo + 1]--;
+            within[(size_t) (i.first - lo) * width + (i.second - lo)]++;
+        }
+        for (int s = 1; s <= width; ++s) {
+            covering[s] += covering[s - 1];
+        }
+        // Prefix sums over the end, then suffix sums over the start
+        for (int a = 0; a < width; ++a) {
+            for (int b = 1; b < width; ++b) {
+                within[(size_t) a * width + b] += within[(size_t) a * width + b - 1];
+            }
+        }
+        for (int a = width - 2; a >= 0; --a) {
+            for (int b = 0; b < width; ++b) {
+                within[(size_t) a * width + b] += within[(size_t) (a + 1) * width + b];
+            }
+        }
+    }
+
+    void build_sparse(std::vector<interval> intervals) {
+        std::sort(intervals.begin(), intervals.end());
+        size_t n = intervals.size();
+        ends_tree.assign(2 * n, {});
+        for (size_t i = 0; i < n; ++i) {
+            sorted_starts.push_back(intervals[i].first);
+            ends_tree[n + i] = {intervals[i].second};
+        }
+        for (size_t i = n - 1; i > 0; --i) {
+            auto &l = ends_tree[2 * i];
+            auto &r = ends_tree[2 * i + 1];
+            ends_tree[i].resize(l.size() + r.size());
+            std::merge(l.begin(), l.end(), r.begin(), r.end(), ends_tree[i].begin());
+        }
+        root = build_tree(std::move(intervals));
+    }
+
+public:
+    interval_index() = default;
+
+    /**
+     * Every interval must have first <= second.
+     */
+    explicit interval_index(const std::vector<interval> &intervals, int dense_limit = default_dense_limit)
+            : _size(intervals.size()) {
+        if (intervals.empty()) {
+            return;
+        }
+        lo = intervals[0].first;
+        int hi = intervals[0].second;
+        for (auto &i: intervals) {
+            lo = std::min(lo, i.first);
+            hi = std::max(hi, i.second);
+        }
+        if ((long) hi - lo < dense_limit) {
+            width = hi - lo + 1;
+            build_dense(intervals);
+        } else {
+            dense = false;
+            build_sparse(intervals);
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return _size; }
+
+    /**
+     * Number of intervals with first <= value <= second.
+     */
+    [[nodiscard]] int count_containing(int value) const {
+        if (dense) {
+            if (value < lo || (long) value - lo >= width) {
+                return 0;
+            }
+            return covering[value - lo];
+        }
+        int result = 0;
+        for (auto node = root.get(); node != nullptr;) {
+            if (value < node->center) {
+                result += (int) (std::upper_bound(node->starts.begin(), node->starts.end(), value) -
+                                 node->starts.begin());
+                node = node->left.get();
+            } else if (value > node->center) {
+                result += (int) (node->ends.end() -
+                                 std::lower_bound(node->ends.begin(), node->ends.end(), value));
+                node = node->right.get();
+            } else {
+                result += (int) node->starts.size();
+                break;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Number of intervals with first <= interval.first && interval.second <= last.
+     */
+    [[nodiscard]] int count_within(int first, int last) const {
+        if (dense) {
+            first = std::max(first, lo);
+            last = (long) last - lo >= width ? lo + width - 1 : last;
+            if (first > last || width == 0) {
+                return 0;
+            }
+            return within[(size_t) (first - lo) * width + (last - lo)];
+        }
+        size_t n = sorted_starts.size();
+        auto l = (size_t) (std::lower_bound(sorted_starts.begin(), sorted_starts.end(), first) -
+                           sorted_starts.begin()) + n;
+        auto r = 2 * n;
+        int result = 0;
+        auto count_ends = [&](const std::vector<int> &ends) {
+            return (int) (std::upper_bound(ends.begin(), ends.end(), last) - ends.begin());
+        };
+        for (; l < r; l >>= 1, r >>= 1) {
+            if (l & 1) {
+                result += count_ends(ends_tree[l++]);
+            }
+            if (r & 1) {
+                result += count_ends(ends_tree[--r]);
+            }
+        }
+        return result;
+    }
+};
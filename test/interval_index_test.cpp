@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "interval_index.h"
+
+using namespace std;
+
+namespace {
+    int brute_force_containing(const vector<interval_index::interval> &intervals, int value) {
+        int result = 0;
+        for (auto &i: intervals) {
+            result += i.first <= value && value <= i.second;
+        }
+        return result;
+    }
+
+    int brute_force_within(const vector<interval_index::interval> &intervals, int first, int last) {
+        int result = 0;
+        for (auto &i: intervals) {
+            result += first <= i.first && i.second <= last;
+        }
+        return result;
+    }
+}
+
+TEST(interval_index, empty) {
+    interval_index index(vector<interval_index::interval>{});
+    ASSERT_EQ(index.size(), 0);
+    ASSERT_EQ(index.count_containing(0), 0);
+    ASSERT_EQ(index.count_within(-10, 10), 0);
+}
+
+TEST(interval_index, matches_brute_force) {
+    mt19937 random(1);
+    for (int span: {1, 10, 100, 1000000}) {
+        uniform_int_distribution<int> value(-span, span);
+        for (int count: {1, 2, 7, 100}) {
+            vector<interval_index::interval> intervals;
+            for (int i = 0; i < count; ++i) {
+                intervals.push_back(minmax(value(random), value(random)));
+            }
+            // Once with whatever mode the span picks, and once forced onto the trees
+            for (int dense_limit: {interval_index::default_dense_limit, 0}) {
+                interval_index index(intervals, dense_limit);
+                for (int q = 0; q < 200; ++q) {
+                    int v = value(random) + value(random) / 4;
+                    ASSERT_EQ(index.count_containing(v), brute_force_containing(intervals, v));
+                    auto [first, last] = minmax(value(random), value(random));
+                    ASSERT_EQ(index.count_within(first, last), brute_force_within(intervals, first, last));
+                    ASSERT_EQ(index.count_within(last, first), brute_force_within(intervals, last, first));
+                }
+                for (auto &i: intervals) {
+                    ASSERT_EQ(index.count_containing(i.first), brute_force_containing(intervals, i.first));
+                    ASSERT_EQ(index.count_containing(i.second), brute_force_containing(intervals, i.second));
+                    ASSERT_EQ(index.count_within(i.first, i.second),
+                              brute_force_within(intervals, i.first, i.second));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#include <vector>
+#endif
+
+/**
+ * Read-only view of a whole file. Memory-mapped where the platform supports it, otherwise read into memory.
+ */
+class mapped_file {
+private:
+    const char *_data{nullptr};
+    size_t _size{0};
+#if defined(__unix__) || defined(__APPLE__)
+    void *mapping{nullptr};
+#else
+    std::vector<char> buffer;
+#endif
+
+public:
+    explicit mapped_file(const std::string &path) {
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("unable to open " + path);
+        }
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("unable to stat " + path);
+        }
+        _size = st.st_size;
+        if (_size > 0) {
+            mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("unable to map " + path);
+            }
+            madvise(mapping, _size, MADV_SEQUENTIAL);
+            _data = static_cast<const char *>(mapping);
+        }
+        close(fd);
+#else
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            throw std::runtime_error("unable to open " + path);
+        }
+        buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        _data = buffer.data();
+        _size = buffer.size();
+#endif
+    }
+
+    mapped_file(const mapped_file &) = delete;
+
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    ~mapped_file() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (mapping != nullptr) {
+            munmap(mapping, _size);
+        }
+#endif
+    }
+
+    [[nodiscard]] const char *data() const { return _data; }
+
+    [[nodiscard]] size_t size() const { return _size; }
+
+    [[nodiscard]] const char *begin() const { return _data; }
+
+    [[nodiscard]] const char *end() const { return _data + _size; }
+
+    [[nodiscard]] std::string_view view() const { return {_data, _size}; }
+};
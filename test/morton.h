@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+#include "pos2.h"
+#include "pos3.h"
+
+/**
+ * Morton (Z-order) keys interleave the bits of each coordinate, so points that are close together in space
+ * tend to be close together in key order. Uses BMI2 pdep/pext when the compiler targets it (e.g. -mbmi2 or
+ * -march=native), and shift-and-mask bit spreading otherwise.
+ */
+inline namespace {
+    using namespace std;
+
+    constexpr uint64_t morton2_x_mask = 0x5555555555555555ull;
+    constexpr uint64_t morton3_x_mask = 0x1249249249249249ull;
+
+    /**
+     * 3D keys have 21 bits per axis, so coordinates must be in [-morton3_bias, morton3_bias). morton_encode3
+     * throws for anything outside that, rather than letting it alias another cell.
+     */
+    constexpr int morton3_bias = 1 << 20;
+
+    constexpr uint64_t morton_spread2(uint64_t v) {
+        v &= 0xffffffffull;
+        v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+        v = (v | (v << 8)) & 0x00ff00ff00ff00ffull;
+        v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0full;
+        v = (v | (v << 2)) & 0x3333333333333333ull;
+        v = (v | (v << 1)) & 0x5555555555555555ull;
+        return v;
+    }
+
+    constexpr uint64_t morton_compact2(uint64_t v) {
+        v &= 0x5555555555555555ull;
+        v = (v | (v >> 1)) & 0x3333333333333333ull;
+        v = (v | (v >> 2)) & 0x0f0f0f0f0f0f0f0full;
+        v = (v | (v >> 4)) & 0x00ff00ff00ff00ffull;
+        v = (v | (v >> 8)) & 0x0000ffff0000ffffull;
+        v = (v | (v >> 16)) & 0x00000000ffffffffull;
+        return v;
+    }
+
+    constexpr uint64_t morton_spread3(uint64_t v) {
+        v &= 0x1fffffull;
+        v = (v | (v << 32)) & 0x001f00000000ffffull;
+        v = (v | (v << 16)) & 0x001f0000ff0000ffull;
+        v = (v | (v << 8)) & 0x100f00f00f00f00full;
+        v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+        v = (v | (v << 2)) & 0x1249249249249249ull;
+        return v;
+    }
+
+    constexpr uint64_t morton_compact3(uint64_t v) {
+        v &= 0x1249249249249249ull;
+        v = (v | (v >> 2)) & 0x10c30c30c30c30c3ull;
+        v = (v | (v >> 4)) & 0x100f00f00f00f00full;
+        v = (v | (v >> 8)) & 0x001f0000ff0000ffull;
+        v = (v | (v >> 16)) & 0x001f00000000ffffull;
+        v = (v | (v >> 32)) & 0x00000000001fffffull;
+        return v;
+    }
+
+    // Flipping the sign bit maps int to uint32 while preserving order.
+    inline uint64_t morton_encode2(int x, int y) {
+        uint64_t ux = (uint32_t) x ^ 0x80000000u;
+        uint64_t uy = (uint32_t) y ^ 0x80000000u;
+#ifdef __BMI2__
+        return _pdep_u64(ux, morton2_x_mask) | _pdep_u64(uy, morton2_x_mask << 1);
+#else
+        return morton_spread2(ux) | (morton_spread2(uy) << 1);
+#endif
+    }
+
+    inline pos2 morton_decode2(uint64_t key) {
+#ifdef __BMI2__
+        auto ux = (uint32_t) _pext_u64(key, morton2_x_mask);
+        auto uy = (uint32_t) _pext_u64(key, morton2_x_mask << 1);
+#else
+        auto ux = (uint32_t) morton_compact2(key);
+        auto uy = (uint32_t) morton_compact2(key >> 1);
+#endif
+        return {(int) (ux ^ 0x80000000u), (int) (uy ^ 0x80000000u)};
+    }
+
+    inline uint64_t morton_encode3(int x, int y, int z) {
+        uint64_t ux = (uint32_t) x + (uint32_t) morton3_bias;
+        uint64_t uy = (uint32_t) y + (uint32_t) morton3_bias;
+        uint64_t uz = (uint32_t) z + (uint32_t) morton3_bias;
+        // in range exactly when each biased coordinate fits in 21 bits
+        if ((ux | uy | uz) >> 21 != 0) {
+            throw logic_error("coordinate out of morton range");
+        }
+#ifdef __BMI2__
+        return _pdep_u64(ux, morton3_x_mask) |
+               _pdep_u64(uy, morton3_x_mask << 1) |
+               _pdep_u64(uz, morton3_x_mask << 2);
+#else
+        return morton_spread3(ux) | (morton_spread3(uy) << 1) | (morton_spread3(uz) << 2);
+#endif
+    }
+
+    inline pos3 morton_decode3(uint64_t key) {
+#ifdef __BMI2__
+        auto ux = (int) _pext_u64(key, morton3_x_mask);
+        auto uy = (int) _pext_u64(key, morton3_x_mask << 1);
+        auto uz = (int) _pext_u64(key, morton3_x_mask << 2);
+#else
+        auto ux = (int) morton_compact3(key);
+        auto uy = (int) morton_compact3(key >> 1);
+        auto uz = (int) morton_compact3(key >> 2);
+#endif
+        return {ux - morton3_bias, uy - morton3_bias, uz - morton3_bias};
+    }
+
+    template <typename P>
+    struct morton_traits;
+
+    template <>
+    struct morton_traits<pos2> {
+        static uint64_t encode(const pos2 &p) { return morton_encode2(p.x, p.y); }
+
+        static pos2 decode(uint64_t key) { return morton_decode2(key); }
+    };
+
+    template <>
+    struct morton_traits<pos3> {
+        static uint64_t encode(const pos3 &p) { return morton_encode3(p.x, p.y, p.z); }
+
+        static pos3 decode(uint64_t key) { return morton_decode3(key); }
+    };
+
+    /**
+     * Set of points stored as a sorted vector of Morton keys. Lookups are binary searches over a flat array,
+     * and since neighbors usually have nearby keys, neighbor-heavy lookups mostly hit the same cache lines.
+     * Iteration is in Z-order.
+     *
+     * Building from a range is O(n log n); individual inserts are O(n), so this is meant for sets that are
+     * built up front and then queried a lot.
+     */
+    template <typename P>
+    class morton_set {
+    private:
+        vector<uint64_t> keys;
+
+    public:
+        class const_iterator {
+        private:
+            vector<uint64_t>::const_iterator iter;
+        public:
+            explicit const_iterator(vector<uint64_t>::const_iterator iter) : iter(iter) {}
+
+            P operator*() const { return morton_traits<P>::decode(*iter); }
+
+            const_iterator &operator++() {
+                ++iter;
+                return *this;
+            }
+
+            bool operator==(const const_iterator &b) const { return iter == b.iter; }
+
+            bool operator!=(const const_iterator &b) const { return iter != b.iter; }
+        };
+
+        morton_set() = default;
+
+        template <typename Iter>
+        morton_set(Iter begin, Iter end) {
+            for (auto iter = begin; iter != end; ++iter) {
+                keys.push_back(morton_traits<P>::encode(*iter));
+            }
+            sort(keys.begin(), keys.end());
+            keys.erase(unique(keys.begin(), keys.end()), keys.end());
+        }
+
+        bool insert(const P &p) {
+            auto key = morton_traits<P>::encode(p);
+            auto iter = lower_bound(keys.begin(), keys.end(), key);
+            if (iter != keys.end() && *iter == key) {
+                return false;
+            }
+            keys.insert(iter, key);
+            return true;
+        }
+
+        [[nodiscard]] bool contains(const P &p) const {
+            return binary_search(keys.begin(), keys.end(), morton_traits<P>::encode(p));
+        }
+
+        [[nodiscard]] size_t size() const { return keys.size(); }
+
+        [[nodiscard]] bool empty() const { return keys.empty(); }
+
+        [[nodiscard]] const_iterator begin() const { return const_iterator(keys.begin()); }
+
+        [[nodiscard]] const_iterator end() const { return const_iterator(keys.end()); }
+    };
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include "morton.h"
+
+using namespace std;
+
+TEST(morton, round_trip) {
+    for (int x: {-1000000, -5, -1, 0, 1, 7, 1048575}) {
+        for (int y: {-1048576, -3, 0, 2, 999999}) {
+            ASSERT_EQ(morton_decode2(morton_encode2(x, y)), (pos2{x, y}));
+            for (int z: {-1048576, 0, 1, 1048575}) {
+                ASSERT_EQ(morton_decode3(morton_encode3(x, y, z)), (pos3{x, y, z}));
+            }
+        }
+    }
+    ASSERT_EQ(morton_decode2(morton_encode2(numeric_limits<int>::min(), numeric_limits<int>::max())),
+              (pos2{numeric_limits<int>::min(), numeric_limits<int>::max()}));
+}
+
+TEST(morton, interleaving) {
+    ASSERT_EQ(morton_spread2(0b1011), 0b1000101);
+    ASSERT_EQ(morton_spread3(0b1011), 0b1000001001);
+    ASSERT_EQ(morton_encode2(1, 0) ^ morton_encode2(0, 0), 0b01);
+    ASSERT_EQ(morton_encode2(0, 1) ^ morton_encode2(0, 0), 0b10);
+    ASSERT_EQ(morton_encode3(0, 0, 1) ^ morton_encode3(0, 0, 0), 0b100);
+}
+
+TEST(morton, encode3_range) {
+    ASSERT_NO_THROW(morton_encode3(-morton3_bias, morton3_bias - 1, 0));
+    for (int bad: {morton3_bias, -morton3_bias - 1, numeric_limits<int>::max(), numeric_limits<int>::min()}) {
+        ASSERT_THROW(morton_encode3(bad, 0, 0), logic_error);
+        ASSERT_THROW(morton_encode3(0, bad, 0), logic_error);
+        ASSERT_THROW(morton_encode3(0, 0, bad), logic_error);
+        ASSERT_THROW(morton_set<pos3>().insert({0, 0, bad}), logic_error);
+    }
+}
+
+TEST(morton, set) {
+    vector<pos2> points{{3, 4}, {-1, 2}, {3, 4}, {0, 0}, {1, 1}};
+    morton_set<pos2> s(points.begin(), points.end());
+
+    ASSERT_EQ(s.size(), 4);
+    ASSERT_TRUE(s.contains({-1, 2}));
+    ASSERT_FALSE(s.contains({2, -1}));
+    ASSERT_TRUE(s.insert({2, -1}));
+    ASSERT_FALSE(s.insert({2, -1}));
+    ASSERT_TRUE(s.contains({2, -1}));
+
+    vector<pos2> in_order;
+    for (const auto &p: s) {
+        in_order.push_back(p);
+    }
+    ASSERT_EQ(in_order, (vector<pos2>{{2, -1}, {-1, 2}, {0, 0}, {1, 1}, {3, 4}}));
+}
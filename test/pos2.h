@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <ostream>
 #include "util.h"
 
@@ -19,7 +22,7 @@ inline namespace {
             return {y, -x};
         }
 
-        pos2_t operator+(const pos2_t &b) const {
+        constexpr pos2_t operator+(const pos2_t &b) const {
             return {x + b.x, y + b.y};
         }
 
@@ -66,24 +69,272 @@ inline namespace {
     using pos2 = pos2_t<int>;
     using pos2_ll = pos2_t<long long>;
 
-    pair<pos2, pos2> bounding_box(const set<pos2> &ps) {
-        int xmin = numeric_limits<int>::max();
-        int ymin = numeric_limits<int>::max();
-        int xmax = numeric_limits<int>::min();
-        int ymax = numeric_limits<int>::min();
-        for (const auto &p: ps) {
-            xmin = min(xmin, p.x);
-            ymin = min(ymin, p.y);
-            xmax = max(xmax, p.x);
-            ymax = max(ymax, p.y);
-        }
-        return {{xmin, ymin}, {xmax, ymax}};
-    }
+    /**
+     * Inclusive box of positions.
+     */
+    struct pos2_bounds {
+        pos2 min;
+        pos2 max;
+
+        [[nodiscard]] constexpr bool contains(const pos2 &p) const {
+            return p.x >= min.x && p.y >= min.y && p.x <= max.x && p.y <= max.y;
+        }
+    };
+
+    constexpr stencil<pos2, 4> adjacent4{{{{0, -1}, {1, 0}, {0, 1}, {-1, 0}}}};
+
+    constexpr stencil<pos2, 8> adjacent8{{{
+            {-1, -1}, {0, -1}, {1, -1},
+            {-1, 0}, {1, 0},
+            {-1, 1}, {0, 1}, {1, 1}}}};
 
     ostream &operator<<(ostream &out, const pos2 &p) {
         out << "{" << p.x << "," << p.y << "}";
         return out;
     }
+
+    /**
+     * The smallest box that contains both old and p, extended by a further `slack` on whichever sides had to
+     * grow. Used by the dense containers below so that repeated growth in one direction is amortized.
+     */
+    pos2_bounds grow_bounds(const pos2_bounds &old, pos2 p, pos2 slack) {
+        return {{min(old.min.x, p.x < old.min.x ? p.x - slack.x : p.x),
+                 min(old.min.y, p.y < old.min.y ? p.y - slack.y : p.y)},
+                {max(old.max.x, p.x > old.max.x ? p.x + slack.x : p.x),
+                 max(old.max.y, p.y > old.max.y ? p.y + slack.y : p.y)}};
+    }
+
+    /**
+     * Copies a row-major block of height rows of stride elements, whose first element is at origin, into a new
+     * block with the given origin and size, filling the rest of the new block with fill. The new block must
+     * cover the old one.
+     */
+    template <typename T>
+    vector<T> move_rows(const vector<T> &cells, pos2 origin, int stride, int height,
+                        pos2 new_origin, int new_stride, int new_height, const T &fill) {
+        vector<T> new_cells((size_t) new_stride * new_height, fill);
+        for (int r = 0; r < height; ++r) {
+            auto src = cells.begin() + (size_t) r * stride;
+            auto dst = new_cells.begin() +
+                       (size_t) (origin.y + r - new_origin.y) * new_stride + (origin.x - new_origin.x);
+            copy(src, src + stride, dst);
+        }
+        return new_cells;
+    }
+
+    /**
+     * Dense 2D grid over an unbounded plane, stored row-major in a single vector.
+     *
+     * Writing through set() grows the storage to cover the written cell, moving the origin if needed, and
+     * extends bounds() to include it. Around the stored area there's always a border of `padding` cells holding
+     * the empty value, so operator[] can read up to `padding` cells past bounds() without any bounds checks.
+     */
+    template <typename T>
+    class grid2 {
+    private:
+        T empty_value;
+        int padding;
+        // first stored cell, including padding
+        pos2 origin{0, 0};
+        int stride{0};
+        int height{0};
+        vector<T> cells;
+        pos2 bmin{numeric_limits<int>::max(), numeric_limits<int>::max()};
+        pos2 bmax{numeric_limits<int>::min(), numeric_limits<int>::min()};
+
+        [[nodiscard]] size_t index_of(pos2 p) const {
+            return (size_t) (p.y - origin.y) * stride + (p.x - origin.x);
+        }
+
+        [[nodiscard]] bool is_interior(pos2 p) const {
+            return p.x >= origin.x + padding && p.x < origin.x + stride - padding &&
+                   p.y >= origin.y + padding && p.y < origin.y + height - padding;
+        }
+
+        void grow_to_include(pos2 p) {
+            if (cells.empty()) {
+                reserve(p, p);
+                return;
+            }
+            pos2_bounds old{{origin.x + padding, origin.y + padding},
+                            {origin.x + stride - padding - 1, origin.y + height - padding - 1}};
+            auto grown = grow_bounds(old, p, {max(4, (old.max.x - old.min.x + 1) / 2),
+                                              max(4, (old.max.y - old.min.y + 1) / 2)});
+            reserve(grown.min, grown.max);
+        }
+
+    public:
+        explicit grid2(T empty_value = T{}, int padding = 1) : empty_value(std::move(empty_value)), padding(padding) {}
+
+        /**
+         * Makes sure cells in the inclusive box [min, max] are stored, without changing bounds().
+         */
+        void reserve(pos2 min, pos2 max) {
+            if (!cells.empty()) {
+                if (is_interior(min) && is_interior(max)) {
+                    return;
+                }
+                min = {std::min(min.x, origin.x + padding), std::min(min.y, origin.y + padding)};
+                max = {std::max(max.x, origin.x + stride - padding - 1),
+                       std::max(max.y, origin.y + height - padding - 1)};
+            }
+
+            pos2 new_origin{min.x - padding, min.y - padding};
+            int new_stride = max.x - min.x + 1 + 2 * padding;
+            int new_height = max.y - min.y + 1 + 2 * padding;
+            cells = move_rows(cells, origin, stride, height, new_origin, new_stride, new_height, empty_value);
+            origin = new_origin;
+            stride = new_stride;
+            height = new_height;
+        }
+
+        /**
+         * Unchecked access. Valid for any cell that has been set() or reserve()d, and up to `padding` cells
+         * beyond those.
+         */
+        const T &operator[](pos2 p) const {
+            return cells[index_of(p)];
+        }
+
+        /**
+         * Unchecked access that neither grows the grid nor extends bounds(). Valid for the same cells as the
+         * const version, but writes into the padding will be seen by later reads.
+         */
+        T &operator[](pos2 p) {
+            return cells[index_of(p)];
+        }
+
+        /**
+         * Checked access that returns the empty value for anything that isn't stored.
+         */
+        const T &get(pos2 p) const {
+            if (p.x < origin.x || p.x >= origin.x + stride || p.y < origin.y || p.y >= origin.y + height) {
+                return empty_value;
+            }
+            return cells[index_of(p)];
+        }
+
+        void set(pos2 p, const T &value) {
+            if (!is_interior(p)) {
+                grow_to_include(p);
+            }
+            cells[index_of(p)] = value;
+            bmin = {min(bmin.x, p.x), min(bmin.y, p.y)};
+            bmax = {max(bmax.x, p.x), max(bmax.y, p.y)};
+        }
+
+        [[nodiscard]] bool empty() const {
+            return bmin.x > bmax.x;
+        }
+
+        /**
+         * Inclusive bounding box of every cell that has been set().
+         */
+        [[nodiscard]] pair<pos2, pos2> bounds() const {
+            return {bmin, bmax};
+        }
+
+        [[nodiscard]] const T &empty_cell() const {
+            return empty_value;
+        }
+
+        /**
+         * The cells of row y from bounds().first.x to bounds().second.x, contiguous in memory.
+         */
+        const T *row_begin(int y) const {
+            return cells.data() + index_of({bmin.x, y});
+        }
+
+        const T *row_end(int y) const {
+            return cells.data() + index_of({bmax.x, y}) + 1;
+        }
+
+        T *row_begin(int y) {
+            return cells.data() + index_of({bmin.x, y});
+        }
+
+        T *row_end(int y) {
+            return cells.data() + index_of({bmax.x, y}) + 1;
+        }
+    };
+
+    /**
+     * Set of pos2 stored as one bit per cell over a dense box that grows as cells are added, in whole 64-bit
+     * words along x. Meant for sets of cells that stay clustered, like the path of something moving around;
+     * the box covers everything between the extremes, so it can be much bigger than the set.
+     */
+    class bitmap2 {
+    private:
+        // first stored cell; origin.x is always a multiple of 64
+        pos2 origin{0, 0};
+        int words_per_row{0};
+        int height{0};
+        vector<uint64_t> words;
+        size_t _size{0};
+
+        [[nodiscard]] bool is_stored(pos2 p) const {
+            return p.x >= origin.x && p.x < origin.x + words_per_row * 64 &&
+                   p.y >= origin.y && p.y < origin.y + height;
+        }
+
+        [[nodiscard]] size_t word_of(pos2 p) const {
+            return (size_t) (p.y - origin.y) * words_per_row + (p.x - origin.x) / 64;
+        }
+
+        static int floor_div64(int x) {
+            return x >= 0 ? x / 64 : -((-x + 63) / 64);
+        }
+
+        void grow_to_include(pos2 p) {
+            pos2_bounds grown{p, p};
+            if (!words.empty()) {
+                // double on whichever sides are growing
+                pos2_bounds old{origin, {origin.x + words_per_row * 64 - 1, origin.y + height - 1}};
+                grown = grow_bounds(old, p, {max(64, words_per_row * 64), max(8, height)});
+            }
+
+            // rows are moved in units of whole words, so x is measured in words here
+            pos2 new_origin{floor_div64(grown.min.x), grown.min.y};
+            int new_words_per_row = floor_div64(grown.max.x) - new_origin.x + 1;
+            int new_height = grown.max.y - grown.min.y + 1;
+            words = move_rows(words, {origin.x / 64, origin.y}, words_per_row, height,
+                              new_origin, new_words_per_row, new_height, uint64_t{0});
+            origin = {new_origin.x * 64, new_origin.y};
+            words_per_row = new_words_per_row;
+            height = new_height;
+        }
+
+    public:
+        /**
+         * Adds p, returning whether it wasn't already there.
+         */
+        bool insert(pos2 p) {
+            if (!is_stored(p)) {
+                grow_to_include(p);
+            }
+            auto &word = words[word_of(p)];
+            auto bit = 1ull << ((p.x - origin.x) % 64);
+            if (word & bit) {
+                return false;
+            }
+            word |= bit;
+            ++_size;
+            return true;
+        }
+
+        [[nodiscard]] bool contains(pos2 p) const {
+            return is_stored(p) && (words[word_of(p)] >> ((p.x - origin.x) % 64) & 1) != 0;
+        }
+
+        [[nodiscard]] size_t size() const { return _size; }
+
+        [[nodiscard]] bool empty() const { return _size == 0; }
+
+        void clear() {
+            fill(words.begin(), words.end(), 0);
+            _size = 0;
+        }
+    };
 }
 
 template <typename T>
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <type_traits>
+#include <vector>
+#include "pos2.h"
+#include "simd.h"
+
+/**
+ * Structure-of-arrays list of positions, for applying the same operation to lots of points at once.
+ *
+ * The pos2_array<int> operations are vectorized: 8 lanes at a time with AVX2, 4 with SSE2, and a scalar loop
+ * for the tail and for every other element type. The instruction set is picked at run time.
+ */
+inline namespace {
+    using namespace std;
+
+#ifdef SIMD_X86
+    namespace pos2_simd {
+#pragma GCC push_options
+#pragma GCC target("avx2")
+        struct avx2 {
+            static constexpr size_t lanes = 8;
+            typedef __m256i vec;
+
+            static vec load(const int *p) { return _mm256_loadu_si256((const __m256i *) p); }
+
+            static void store(int *p, vec v) { _mm256_storeu_si256((__m256i *) p, v); }
+
+            static vec splat(int v) { return _mm256_set1_epi32(v); }
+
+            static vec add(vec a, vec b) { return _mm256_add_epi32(a, b); }
+
+            static vec sub(vec a, vec b) { return _mm256_sub_epi32(a, b); }
+
+            static vec abs(vec a) { return _mm256_abs_epi32(a); }
+
+            static vec min(vec a, vec b) { return _mm256_min_epi32(a, b); }
+
+            static vec max(vec a, vec b) { return _mm256_max_epi32(a, b); }
+
+            static vec cmpeq(vec a, vec b) { return _mm256_cmpeq_epi32(a, b); }
+
+            static vec cmpgt(vec a, vec b) { return _mm256_cmpgt_epi32(a, b); }
+
+            static vec bit_and(vec a, vec b) { return _mm256_and_si256(a, b); }
+
+            /**
+             * One bit per lane, set where the lane is all ones.
+             */
+            static unsigned mask(vec v) { return (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(v)); }
+
+#include "pos2_array_kernels.h"
+        };
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+        struct sse2 {
+            static constexpr size_t lanes = 4;
+            typedef __m128i vec;
+
+            static vec load(const int *p) { return _mm_loadu_si128((const __m128i *) p); }
+
+            static void store(int *p, vec v) { _mm_storeu_si128((__m128i *) p, v); }
+
+            static vec splat(int v) { return _mm_set1_epi32(v); }
+
+            static vec add(vec a, vec b) { return _mm_add_epi32(a, b); }
+
+            static vec sub(vec a, vec b) { return _mm_sub_epi32(a, b); }
+
+            static vec cmpeq(vec a, vec b) { return _mm_cmpeq_epi32(a, b); }
+
+            static vec cmpgt(vec a, vec b) { return _mm_cmpgt_epi32(a, b); }
+
+            static vec bit_and(vec a, vec b) { return _mm_and_si128(a, b); }
+
+            // SSE2 has no 32-bit abs/min/max, so build them from shifts, compares and selects
+            static vec abs(vec a) {
+                auto sign = _mm_srai_epi32(a, 31);
+                return _mm_sub_epi32(_mm_xor_si128(a, sign), sign);
+            }
+
+            static vec select(vec m, vec a, vec b) { return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+
+            static vec min(vec a, vec b) { return select(_mm_cmpgt_epi32(a, b), b, a); }
+
+            static vec max(vec a, vec b) { return select(_mm_cmpgt_epi32(a, b), a, b); }
+
+            static unsigned mask(vec v) { return (unsigned) _mm_movemask_ps(_mm_castsi128_ps(v)); }
+
+#include "pos2_array_kernels.h"
+        };
+#pragma GCC pop_options
+    }
+#endif
+
+    template <typename T>
+    class pos2_array {
+    private:
+        vector<T> xs;
+        vector<T> ys;
+        simd_kernel kernel = best_kernel();
+
+        /**
+         * Calls f with the pos2_simd struct for the chosen kernel and returns true, or returns false if the
+         * operation should be done entirely by the scalar loop.
+         */
+        template <typename F>
+        bool with_simd(F f) const {
+#ifdef SIMD_X86
+            if constexpr (is_same_v<T, int>) {
+                if (kernel == simd_kernel::avx2) {
+                    f(pos2_simd::avx2{});
+                    return true;
+                } else if (kernel != simd_kernel::scalar) {
+                    f(pos2_simd::sse2{});
+                    return true;
+                }
+            }
+#endif
+            return false;
+        }
+
+    public:
+        pos2_array() = default;
+
+        template <typename Iter>
+        pos2_array(Iter begin, Iter end) {
+            for (auto iter = begin; iter != end; ++iter) {
+                push_back(*iter);
+            }
+        }
+
+        [[nodiscard]] size_t size() const { return xs.size(); }
+
+        [[nodiscard]] bool empty() const { return xs.empty(); }
+
+        void push_back(const pos2_t<T> &p) {
+            xs.push_back(p.x);
+            ys.push_back(p.y);
+        }
+
+        [[nodiscard]] pos2_t<T> operator[](size_t i) const {
+            return {xs[i], ys[i]};
+        }
+
+        void set(size_t i, const pos2_t<T> &p) {
+            xs[i] = p.x;
+            ys[i] = p.y;
+        }
+
+        /**
+         * Which instruction set the vectorized operations use, best_kernel() by default.
+         */
+        void use_kernel(simd_kernel k) {
+            if (!kernel_supported(k)) {
+                throw logic_error("unsupported kernel");
+            }
+            kernel = k;
+        }
+
+        [[nodiscard]] const T *x_data() const { return xs.data(); }
+
+        [[nodiscard]] const T *y_data() const { return ys.data(); }
+
+        /**
+         * Adds offset to every position.
+         */
+        pos2_array &operator+=(const pos2_t<T> &offset) {
+            size_t i = 0;
+            with_simd([&](auto isa) {
+                decltype(isa)::add_offset(xs.data(), ys.data(), size(), i, offset.x, offset.y);
+            });
+            for (; i < size(); ++i) {
+                xs[i] += offset.x;
+                ys[i] += offset.y;
+            }
+            return *this;
+        }
+
+        /**
+         * Adds each of other's positions to the position at the same index. Both must be the same size.
+         */
+        pos2_array &operator+=(const pos2_array &other) {
+            size_t i = 0;
+            with_simd([&](auto isa) {
+                decltype(isa)::add_each(xs.data(), ys.data(), other.xs.data(), other.ys.data(), size(), i);
+            });
+            for (; i < size(); ++i) {
+                xs[i] += other.xs[i];
+                ys[i] += other.ys[i];
+            }
+            return *this;
+        }
+
+        /**
+         * out[i] = (*this)[i].manhattan_distance_to(p). out must have room for size() values.
+         */
+        void manhattan_distances_to(const pos2_t<T> &p, T *out) const {
+            size_t i = 0;
+            with_simd([&](auto isa) {
+                decltype(isa)::manhattan_distances(xs.data(), ys.data(), size(), i, p.x, p.y, out);
+            });
+            for (; i < size(); ++i) {
+                out[i] = pos2_t<T>{xs[i], ys[i]}.manhattan_distance_to(p);
+            }
+        }
+
+        [[nodiscard]] vector<T> manhattan_distances_to(const pos2_t<T> &p) const {
+            vector<T> result(size());
+            manhattan_distances_to(p, result.data());
+            return result;
+        }
+
+        /**
+         * Whether p is within radii[i] of (*this)[i] for any i. radii must have size() values.
+         */
+        [[nodiscard]] bool any_within(const pos2_t<T> &p, const T *radii) const {
+            size_t i = 0;
+            bool found = false;
+            with_simd([&](auto isa) {
+                found = decltype(isa)::any_within(xs.data(), ys.data(), size(), i, p.x, p.y, radii);
+            });
+            if (found) {
+                return true;
+            }
+            for (; i < size(); ++i) {
+                if (pos2_t<T>{xs[i], ys[i]}.manhattan_distance_to(p) <= radii[i]) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Number of positions equal to p.
+         */
+        [[nodiscard]] size_t count(const pos2_t<T> &p) const {
+            size_t result = 0;
+            size_t i = 0;
+            with_simd([&](auto isa) {
+                result = decltype(isa)::count(xs.data(), ys.data(), size(), i, p.x, p.y);
+            });
+            for (; i < size(); ++i) {
+                result += pos2_t<T>{xs[i], ys[i]} == p;
+            }
+            return result;
+        }
+
+        /**
+         * Index of the first position equal to p, or size() if there isn't one.
+         */
+        [[nodiscard]] size_t find(const pos2_t<T> &p) const {
+            size_t i = 0;
+            bool found = false;
+            with_simd([&](auto isa) {
+                found = decltype(isa)::find(xs.data(), ys.data(), size(), i, p.x, p.y);
+            });
+            if (found) {
+                return i;
+            }
+            for (; i < size(); ++i) {
+                if (pos2_t<T>{xs[i], ys[i]} == p) {
+                    return i;
+                }
+            }
+            return size();
+        }
+
+        /**
+         * Inclusive bounding box of all positions. Undefined if empty.
+         */
+        [[nodiscard]] pair<pos2_t<T>, pos2_t<T>> bounds() const {
+            pos2_t<T> lo{xs[0], ys[0]};
+            pos2_t<T> hi = lo;
+            size_t i = 0;
+            with_simd([&](auto isa) {
+                decltype(isa)::bounds(xs.data(), ys.data(), size(), i, lo, hi);
+            });
+            for (; i < size(); ++i) {
+                lo.x = std::min(lo.x, xs[i]);
+                hi.x = std::max(hi.x, xs[i]);
+                lo.y = std::min(lo.y, ys[i]);
+                hi.y = std::max(hi.y, ys[i]);
+            }
+            return {lo, hi};
+        }
+    };
+}
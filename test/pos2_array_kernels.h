@@ -0,0 +1,100 @@
+// The vectorized pos2_array<int> operations. pos2_array.h includes this once inside each instruction set's struct,
+// which supplies lanes, vec and the lane operations, so the kernels are written once but compiled for each
+// target. Every kernel works through whole groups of lanes starting at i and leaves i at the first element it
+// didn't handle, for the caller's scalar loop to finish.
+
+static void add_offset(int *xs, int *ys, size_t n, size_t &i, int dx, int dy) {
+    auto vdx = splat(dx);
+    auto vdy = splat(dy);
+    for (; i + lanes <= n; i += lanes) {
+        store(xs + i, add(load(xs + i), vdx));
+        store(ys + i, add(load(ys + i), vdy));
+    }
+}
+
+static void add_each(int *xs, int *ys, const int *other_xs, const int *other_ys, size_t n, size_t &i) {
+    for (; i + lanes <= n; i += lanes) {
+        store(xs + i, add(load(xs + i), load(other_xs + i)));
+        store(ys + i, add(load(ys + i), load(other_ys + i)));
+    }
+}
+
+static void manhattan_distances(const int *xs, const int *ys, size_t n, size_t &i, int x, int y, int *out) {
+    auto px = splat(x);
+    auto py = splat(y);
+    for (; i + lanes <= n; i += lanes) {
+        store(out + i, add(abs(sub(load(xs + i), px)), abs(sub(load(ys + i), py))));
+    }
+}
+
+static bool any_within(const int *xs, const int *ys, size_t n, size_t &i, int x, int y, const int *radii) {
+    auto px = splat(x);
+    auto py = splat(y);
+    for (; i + lanes <= n; i += lanes) {
+        auto d = add(abs(sub(load(xs + i), px)), abs(sub(load(ys + i), py)));
+        auto too_far = cmpgt(d, load(radii + i));
+        if (mask(too_far) != (1u << lanes) - 1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static size_t count(const int *xs, const int *ys, size_t n, size_t &i, int x, int y) {
+    auto px = splat(x);
+    auto py = splat(y);
+    size_t result = 0;
+    for (; i + lanes <= n; i += lanes) {
+        auto eq = bit_and(cmpeq(load(xs + i), px), cmpeq(load(ys + i), py));
+        result += __builtin_popcount(mask(eq));
+    }
+    return result;
+}
+
+/**
+ * On a match, returns true with i at the matching element.
+ */
+static bool find(const int *xs, const int *ys, size_t n, size_t &i, int x, int y) {
+    auto px = splat(x);
+    auto py = splat(y);
+    for (; i + lanes <= n; i += lanes) {
+        auto m = mask(bit_and(cmpeq(load(xs + i), px), cmpeq(load(ys + i), py)));
+        if (m != 0) {
+            i += __builtin_ctz(m);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Widens the box [lo, hi] to cover the elements it handles.
+ */
+static void bounds(const int *xs, const int *ys, size_t n, size_t &i, pos2 &lo, pos2 &hi) {
+    if (i + lanes > n) {
+        return;
+    }
+    auto xmin = load(xs + i);
+    auto xmax = xmin;
+    auto ymin = load(ys + i);
+    auto ymax = ymin;
+    for (i += lanes; i + lanes <= n; i += lanes) {
+        auto x = load(xs + i);
+        auto y = load(ys + i);
+        xmin = min(xmin, x);
+        xmax = max(xmax, x);
+        ymin = min(ymin, y);
+        ymax = max(ymax, y);
+    }
+    int buf[4][lanes];
+    store(buf[0], xmin);
+    store(buf[1], xmax);
+    store(buf[2], ymin);
+    store(buf[3], ymax);
+    for (size_t l = 0; l < lanes; ++l) {
+        lo.x = std::min(lo.x, buf[0][l]);
+        hi.x = std::max(hi.x, buf[1][l]);
+        lo.y = std::min(lo.y, buf[2][l]);
+        hi.y = std::max(hi.y, buf[3][l]);
+    }
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <random>
+#include "pos2_array.h"
+
+using namespace std;
+
+template <typename T>
+vector<pos2_t<T>> random_positions(size_t count, unsigned seed) {
+    mt19937 rng(seed);
+    uniform_int_distribution<T> dist(-1000000, 1000000);
+    vector<pos2_t<T>> result;
+    for (size_t i = 0; i < count; ++i) {
+        result.push_back({dist(rng), dist(rng)});
+    }
+    return result;
+}
+
+template <typename T>
+void check_matches_scalar(simd_kernel kernel) {
+    // odd sizes so that the scalar tail loops get exercised too
+    for (size_t count: {1, 7, 8, 9, 37, 1000}) {
+        auto points = random_positions<T>(count, count);
+        auto others = random_positions<T>(count, count + 1);
+        pos2_array<T> arr(points.begin(), points.end());
+        arr.use_kernel(kernel);
+        pos2_t<T> p{12345, -6789};
+
+        auto distances = arr.manhattan_distances_to(p);
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_EQ(distances[i], points[i].manhattan_distance_to(p));
+        }
+
+        vector<T> radii(count);
+        for (size_t i = 0; i < count; ++i) {
+            radii[i] = points[i].manhattan_distance_to(p) - 1;
+        }
+        ASSERT_FALSE(arr.any_within(p, radii.data()));
+        radii[count - 1] += 1;
+        ASSERT_TRUE(arr.any_within(p, radii.data()));
+
+        auto target = points[count / 2];
+        ASSERT_EQ(arr.find(target), find(points.begin(), points.end(), target) - points.begin());
+        ASSERT_EQ(arr.count(target), count_if(points.begin(), points.end(), [&](auto q) { return q == target; }));
+        ASSERT_EQ(arr.find(pos2_t<T>{2000000, 2000000}), count);
+
+        pos2_t<T> lo = points[0];
+        pos2_t<T> hi = points[0];
+        for (const auto &q: points) {
+            lo = {min(lo.x, q.x), min(lo.y, q.y)};
+            hi = {max(hi.x, q.x), max(hi.y, q.y)};
+        }
+        ASSERT_EQ(arr.bounds(), (pair<pos2_t<T>, pos2_t<T>>{lo, hi}));
+
+        arr += p;
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_EQ(arr[i], points[i] + p);
+        }
+        arr += pos2_array<T>(others.begin(), others.end());
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_EQ(arr[i], points[i] + p + others[i]);
+        }
+    }
+}
+
+TEST(pos2_array, matches_scalar_int) {
+    for (auto kernel: supported_kernels()) {
+        check_matches_scalar<int>(kernel);
+    }
+}
+
+TEST(pos2_array, matches_scalar_long_long) {
+    check_matches_scalar<long long>(best_kernel());
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include "util.h"
 
 inline namespace {
@@ -9,13 +10,21 @@ inline namespace {
         int x;
         int y;
         int z;
+
+        constexpr pos3 operator+(const pos3 &b) const {
+            return {x + b.x, y + b.y, z + b.z};
+        }
+
+        constexpr bool operator==(const pos3 &b) const {
+            return x == b.x && y == b.y && z == b.z;
+        }
     };
 
     struct pos3_bounds {
         pos3 min;
         pos3 max;
 
-        [[nodiscard]] bool contains(const pos3 &p) const {
+        [[nodiscard]] constexpr bool contains(const pos3 &p) const {
             return p.x >= min.x &&
                    p.y >= min.y &&
                    p.z >= min.z &&
@@ -42,17 +51,32 @@ inline namespace {
         return {pmin, pmax};
     }
 
-    vector<pos3> pos3_adjacent(const pos3 &p) {
-        vector<pos3> result(6);
-        result.push_back({p.x - 1, p.y, p.z});
-        result.push_back({p.x + 1, p.y, p.z});
-        result.push_back({p.x, p.y - 1, p.z});
-        result.push_back({p.x, p.y + 1, p.z});
-        result.push_back({p.x, p.y, p.z - 1});
-        result.push_back({p.x, p.y, p.z + 1});
+    constexpr stencil<pos3, 6> adjacent6{{{
+            {-1, 0, 0}, {1, 0, 0},
+            {0, -1, 0}, {0, 1, 0},
+            {0, 0, -1}, {0, 0, 1}}}};
+
+    constexpr stencil<pos3, 26> make_adjacent26() {
+        stencil<pos3, 26> result{};
+        size_t i = 0;
+        for (int dz = -1; dz <= 1; ++dz) {
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    if (dx != 0 || dy != 0 || dz != 0) {
+                        result.offsets[i++] = {dx, dy, dz};
+                    }
+                }
+            }
+        }
         return result;
     }
 
+    constexpr stencil<pos3, 26> adjacent26 = make_adjacent26();
+
+    constexpr array<pos3, 6> pos3_adjacent(const pos3 &p) {
+        return adjacent6.around(p);
+    }
+
     auto pos3_comparer = compare_items<pos3>()
             .then_by(&pos3::x)
             .then_by(&pos3::y)
@@ -72,4 +96,199 @@ inline namespace {
     pos3_ordered_set make_pos3_ordered_set() {
         return pos3_ordered_set(pos3_less_comparer);
     }
+
+    /**
+     * Bit-packed 3D volume covering a pos3_bounds plus a one-cell empty border on every side. Each (y, z) row
+     * is a run of 64-bit words with x along the bits, so whole-volume operations like shifting by one cell or
+     * counting the faces between two volumes work a word at a time.
+     */
+    class voxel_grid {
+    private:
+        pos3 origin;
+        int size_x;
+        int size_y;
+        int size_z;
+        int words_per_row;
+        uint64_t tail_mask;
+        vector<uint64_t> words;
+
+        [[nodiscard]] size_t row_start(int y, int z) const {
+            return ((size_t) z * size_y + y) * words_per_row;
+        }
+
+        [[nodiscard]] size_t bit_index(const pos3 &p) const {
+            return row_start(p.y - origin.y, p.z - origin.z) * 64 + (p.x - origin.x);
+        }
+
+        void clear_tails() {
+            for (size_t i = words_per_row - 1; i < words.size(); i += words_per_row) {
+                words[i] &= tail_mask;
+            }
+        }
+
+    public:
+        static constexpr int padding = 1;
+
+        explicit voxel_grid(const struct pos3_bounds &bounds)
+                : origin{bounds.min.x - padding, bounds.min.y - padding, bounds.min.z - padding},
+                  size_x(bounds.max.x - bounds.min.x + 1 + 2 * padding),
+                  size_y(bounds.max.y - bounds.min.y + 1 + 2 * padding),
+                  size_z(bounds.max.z - bounds.min.z + 1 + 2 * padding),
+                  words_per_row((size_x + 63) / 64),
+                  tail_mask(size_x % 64 == 0 ? ~0ull : (1ull << (size_x % 64)) - 1),
+                  words((size_t) words_per_row * size_y * size_z) {}
+
+        /**
+         * The bounds the volume was created for, not including the border.
+         */
+        [[nodiscard]] struct pos3_bounds bounds() const {
+            return {{origin.x + padding, origin.y + padding, origin.z + padding},
+                    {origin.x + size_x - 1 - padding, origin.y + size_y - 1 - padding, origin.z + size_z - 1 - padding}};
+        }
+
+        /**
+         * Everything that can be stored, including the border.
+         */
+        [[nodiscard]] struct pos3_bounds extent() const {
+            return {origin, {origin.x + size_x - 1, origin.y + size_y - 1, origin.z + size_z - 1}};
+        }
+
+        [[nodiscard]] bool test(const pos3 &p) const {
+            auto i = bit_index(p);
+            return (words[i / 64] >> (i % 64)) & 1;
+        }
+
+        void set(const pos3 &p) {
+            auto i = bit_index(p);
+            words[i / 64] |= 1ull << (i % 64);
+        }
+
+        /**
+         * Sets every cell on the outside faces of the extent.
+         */
+        void set_border() {
+            for (int z = 0; z < size_z; ++z) {
+                for (int y = 0; y < size_y; ++y) {
+                    auto row = row_start(y, z);
+                    if (z == 0 || y == 0 || z == size_z - 1 || y == size_y - 1) {
+                        fill(words.begin() + row, words.begin() + row + words_per_row, ~0ull);
+                        words[row + words_per_row - 1] &= tail_mask;
+                    } else {
+                        words[row] |= 1;
+                        auto last = size_x - 1;
+                        words[row + last / 64] |= 1ull << (last % 64);
+                    }
+                }
+            }
+        }
+
+        [[nodiscard]] size_t count() const {
+            size_t result = 0;
+            for (auto w: words) {
+                result += __builtin_popcountll(w);
+            }
+            return result;
+        }
+
+        /**
+         * Number of cells set in both this and other, which must have the same extent.
+         */
+        [[nodiscard]] size_t count_and(const voxel_grid &other) const {
+            size_t result = 0;
+            for (size_t i = 0; i < words.size(); ++i) {
+                result += __builtin_popcountll(words[i] & other.words[i]);
+            }
+            return result;
+        }
+
+        /**
+         * The volume moved by a unit offset along one axis, i.e. result[p] == (*this)[p - offset]. Cells that
+         * would come from outside the extent are clear.
+         */
+        [[nodiscard]] voxel_grid shifted(const pos3 &offset) const {
+            voxel_grid result(bounds());
+            if (offset.x != 0) {
+                for (size_t row = 0; row < words.size(); row += words_per_row) {
+                    for (int w = 0; w < words_per_row; ++w) {
+                        if (offset.x > 0) {
+                            uint64_t carry = w > 0 ? words[row + w - 1] >> 63 : 0;
+                            result.words[row + w] = (words[row + w] << 1) | carry;
+                        } else {
+                            uint64_t carry = w + 1 < words_per_row ? words[row + w + 1] << 63 : 0;
+                            result.words[row + w] = (words[row + w] >> 1) | carry;
+                        }
+                    }
+                }
+                result.clear_tails();
+            } else if (offset.y != 0 || offset.z != 0) {
+                for (int z = 0; z < size_z; ++z) {
+                    for (int y = 0; y < size_y; ++y) {
+                        int src_y = y - offset.y;
+                        int src_z = z - offset.z;
+                        if (src_y < 0 || src_z < 0 || src_y >= size_y || src_z >= size_z) {
+                            continue;
+                        }
+                        copy(words.begin() + row_start(src_y, src_z),
+                             words.begin() + row_start(src_y, src_z) + words_per_row,
+                             result.words.begin() + row_start(y, z));
+                    }
+                }
+            }
+            return result;
+        }
+
+        /**
+         * Number of faces shared between a cell set in this and a cell set in other, which must have the same
+         * extent. For a single volume, 6 * count() - count_faces_against(*this) is its surface area.
+         */
+        [[nodiscard]] size_t count_faces_against(const voxel_grid &other) const {
+            size_t result = 0;
+            for (const auto &offset: adjacent6.offsets) {
+                result += count_and(other.shifted(offset));
+            }
+            return result;
+        }
+
+        /**
+         * This volume grown by one cell in each of the 6 axis directions.
+         */
+        [[nodiscard]] voxel_grid dilated() const {
+            voxel_grid result = *this;
+            for (const auto &offset: adjacent6.offsets) {
+                result |= shifted(offset);
+            }
+            return result;
+        }
+
+        voxel_grid &operator|=(const voxel_grid &b) {
+            for (size_t i = 0; i < words.size(); ++i) {
+                words[i] |= b.words[i];
+            }
+            return *this;
+        }
+
+        voxel_grid &operator&=(const voxel_grid &b) {
+            for (size_t i = 0; i < words.size(); ++i) {
+                words[i] &= b.words[i];
+            }
+            return *this;
+        }
+
+        voxel_grid operator~() const {
+            voxel_grid result = *this;
+            for (auto &w: result.words) {
+                w = ~w;
+            }
+            result.clear_tails();
+            return result;
+        }
+
+        bool operator==(const voxel_grid &b) const {
+            return words == b.words;
+        }
+
+        bool operator!=(const voxel_grid &b) const {
+            return words != b.words;
+        }
+    };
 }
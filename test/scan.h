@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "simd.h"
+
+/**
+ * Helpers for pulling lines and numbers straight out of an in-memory buffer, without going through iostreams.
+ */
+inline namespace {
+
+#ifdef SIMD_X86
+    /**
+     * The newline search of for_each_line over whole 32-byte blocks starting at p. Returns where it stopped.
+     */
+    template <typename F>
+    __attribute__((target("avx2")))
+    const char *for_each_line_avx2(const char *p, const char *end, const char *&line_start, F &f) {
+        const auto newline = _mm256_set1_epi8('\n');
+        for (; end - p >= 32; p += 32) {
+            auto block = _mm256_loadu_si256((const __m256i *) p);
+            auto mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline));
+            while (mask != 0) {
+                const char *found = p + __builtin_ctz(mask);
+                f(line_start, found);
+                line_start = found + 1;
+                mask &= mask - 1;
+            }
+        }
+        return p;
+    }
+
+    /**
+     * for_each_line_avx2, 16 bytes at a time.
+     */
+    template <typename F>
+    __attribute__((target("sse2")))
+    const char *for_each_line_sse2(const char *p, const char *end, const char *&line_start, F &f) {
+        const auto newline = _mm_set1_epi8('\n');
+        for (; end - p >= 16; p += 16) {
+            auto block = _mm_loadu_si128((const __m128i *) p);
+            auto mask = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+            while (mask != 0) {
+                const char *found = p + __builtin_ctz(mask);
+                f(line_start, found);
+                line_start = found + 1;
+                mask &= mask - 1;
+            }
+        }
+        return p;
+    }
+#endif
+
+    /**
+     * Calls f(line_begin, line_end) for every line in [begin, end), not including the '\n'. A final line without
+     * a trailing newline is still reported. Newlines are found 32 (AVX2) or 16 (SSE2) bytes at a time.
+     */
+    template <typename F>
+    void for_each_line(const char *begin, const char *end, F f, simd_kernel kernel = best_kernel()) {
+        const char *line_start = begin;
+        const char *p = begin;
+#ifdef SIMD_X86
+        if (kernel == simd_kernel::avx2) {
+            p = for_each_line_avx2(p, end, line_start, f);
+        } else if (kernel != simd_kernel::scalar) {
+            p = for_each_line_sse2(p, end, line_start, f);
+        }
+#endif
+        for (; p < end; ++p) {
+            if (*p == '\n') {
+                f(line_start, p);
+                line_start = p + 1;
+            }
+        }
+        if (line_start < end) {
+            f(line_start, end);
+        }
+    }
+
+    /**
+     * Parses the decimal digits in [begin, end), throwing if there's anything else in there. limit is the end of
+     * the readable buffer, which may be past end.
+     *
+     * Up to 8 digits are handled without branching on the individual characters: they're loaded as one
+     * little-endian word, checked with one mask test, shifted so the last digit lands in the top byte, and then
+     * pairs, quads and octets of digits are combined with multiplies
+     * (see https://lemire.me/blog/2022/01/21/swar-explained-parsing-eight-digits/).
+     */
+    inline uint64_t parse_digits(const char *begin, const char *end, const char *limit) {
+        size_t len = end - begin;
+        if (len == 0) {
+            return 0;
+        }
+        if (len <= 8) {
+            uint64_t chunk = 0;
+            memcpy(&chunk, begin, limit - begin >= 8 ? 8 : len);
+            // A byte is a digit when its high nibble is 3 and adding 6 to its low nibble doesn't carry out of it
+            uint64_t used = len == 8 ? ~0ull : (1ull << 8 * len) - 1;
+            uint64_t high = chunk & 0xf0f0f0f0f0f0f0f0ull;
+            uint64_t carry = ((chunk & 0x0f0f0f0f0f0f0f0full) + 0x0606060606060606ull) & 0xf0f0f0f0f0f0f0f0ull;
+            if (((high ^ 0x3030303030303030ull) | carry) & used) {
+                throw std::logic_error("invalid digits");
+            }
+            chunk -= 0x3030303030303030ull;
+            chunk <<= 8 * (8 - len);
+            chunk = (chunk * 10 + (chunk >> 8)) & 0x00ff00ff00ff00ffull;
+            chunk = (chunk * 100 + (chunk >> 16)) & 0x0000ffff0000ffffull;
+            chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000ffffffffull;
+            return chunk;
+        }
+        uint64_t result = 0;
+        for (auto p = begin; p < end; ++p) {
+            if (*p < '0' || *p > '9') {
+                throw std::logic_error("invalid digits");
+            }
+            result = result * 10 + (*p - '0');
+        }
+        return result;
+    }
+}
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "scan.h"
+
+using namespace std;
+
+vector<string> lines_of(const string &input, simd_kernel kernel) {
+    vector<string> result;
+    for_each_line(input.data(), input.data() + input.size(), [&](const char *begin, const char *end) {
+        result.emplace_back(begin, end);
+    }, kernel);
+    return result;
+}
+
+TEST(scan, for_each_line) {
+    ASSERT_EQ(lines_of("", simd_kernel::scalar), vector<string>{});
+    ASSERT_EQ(lines_of("a\n\nbc\nd", simd_kernel::scalar), (vector<string>{"a", "", "bc", "d"}));
+
+    mt19937 random(1);
+    for (size_t length: {0, 1, 15, 16, 17, 31, 32, 33, 100, 1000}) {
+        string input;
+        for (size_t i = 0; i < length; ++i) {
+            input += random() % 4 == 0 ? '\n' : char('a' + random() % 26);
+        }
+        auto expected = lines_of(input, simd_kernel::scalar);
+        for (auto kernel: supported_kernels()) {
+            ASSERT_EQ(lines_of(input, kernel), expected);
+        }
+    }
+}
+
+uint64_t parse(const string &digits) {
+    // parse_digits may read up to 8 bytes from begin, so give it a padded buffer like a mapped file would
+    string buffer = digits + string(8, 'x');
+    return parse_digits(buffer.data(), buffer.data() + digits.size(), buffer.data() + buffer.size());
+}
+
+TEST(scan, parse_digits) {
+    ASSERT_EQ(parse(""), 0);
+    ASSERT_EQ(parse("0"), 0);
+    ASSERT_EQ(parse("7"), 7);
+    ASSERT_EQ(parse("1234"), 1234);
+    ASSERT_EQ(parse("12345678"), 12345678);
+    ASSERT_EQ(parse("123456789012"), 123456789012ull);
+    ASSERT_EQ(parse("09090909"), 9090909);
+
+    for (string bad: {"12\r", " 12", "1a", "12:4", "/", "1234567 ", "123456789x", "-1"}) {
+        ASSERT_THROW(parse(bad), logic_error);
+    }
+    for (char c = 0; c >= 0 && c < 127; ++c) {
+        string digits = "1234" + string(1, c) + "56";
+        if (c >= '0' && c <= '9') {
+            ASSERT_EQ(parse(digits), 1234 * 1000 + (c - '0') * 100 + 56);
+        } else {
+            ASSERT_THROW(parse(digits), logic_error);
+        }
+    }
+}
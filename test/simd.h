@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * Instruction sets that the SIMD kernels are written for. Kernels are compiled with target attributes rather than
+ * -m flags, so all of them are built whatever the compiler flags are, and the widest one the CPU supports is
+ * picked at run time. Each instruction set includes the ones listed before it.
+ */
+inline namespace {
+
+    enum class simd_kernel {
+        scalar,
+        sse2,
+        ssse3,
+        avx2
+    };
+
+    inline bool kernel_supported(simd_kernel kernel) {
+        switch (kernel) {
+            case simd_kernel::scalar:
+                return true;
+#ifdef SIMD_X86
+            case simd_kernel::sse2:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("sse2");
+            case simd_kernel::ssse3:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("ssse3");
+            case simd_kernel::avx2:
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2");
+#endif
+            default:
+                return false;
+        }
+    }
+
+    inline simd_kernel best_kernel() {
+        static const simd_kernel best = kernel_supported(simd_kernel::avx2) ? simd_kernel::avx2 :
+                                        kernel_supported(simd_kernel::ssse3) ? simd_kernel::ssse3 :
+                                        kernel_supported(simd_kernel::sse2) ? simd_kernel::sse2 :
+                                        simd_kernel::scalar;
+        return best;
+    }
+
+    /**
+     * Every kernel this CPU can run, scalar first, so tests can check each one against the scalar code.
+     */
+    inline std::vector<simd_kernel> supported_kernels() {
+        std::vector<simd_kernel> result;
+        for (auto kernel: {simd_kernel::scalar, simd_kernel::sse2, simd_kernel::ssse3, simd_kernel::avx2}) {
+            if (kernel_supported(kernel)) {
+                result.push_back(kernel);
+            }
+        }
+        return result;
+    }
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <compare>
 #include <functional>
 #include <sstream>
@@ -9,6 +10,7 @@
 #include <vector>
 
 inline namespace {
+    using std::array;
     using std::common_type;
     using std::function;
     using std::iterator_traits;
@@ -460,4 +462,67 @@ inline namespace {
         std::hash<T> hasher;
         seed ^= hasher(v) + 0x9e3779b9 + (seed<<6) + (seed>>2);
     }
+
+    /**
+     * Up to N items stored inline, for results that have a small fixed upper bound on their size.
+     */
+    template <typename T, size_t N>
+    class neighbor_list {
+    private:
+        array<T, N> items{};
+        size_t count{0};
+    public:
+        constexpr void push_back(const T &item) {
+            items[count++] = item;
+        }
+
+        [[nodiscard]] constexpr const T *begin() const { return items.data(); }
+
+        [[nodiscard]] constexpr const T *end() const { return items.data() + count; }
+
+        [[nodiscard]] constexpr size_t size() const { return count; }
+
+        [[nodiscard]] constexpr bool empty() const { return count == 0; }
+    };
+
+    /**
+     * A fixed set of offsets from a center position, e.g. the 4 orthogonal neighbors of a grid cell.
+     */
+    template <typename P, size_t N>
+    struct stencil {
+        array<P, N> offsets;
+
+        [[nodiscard]] constexpr size_t size() const { return N; }
+
+        [[nodiscard]] constexpr array<P, N> around(const P &center) const {
+            array<P, N> result{};
+            for (size_t i = 0; i < N; ++i) {
+                result[i] = center + offsets[i];
+            }
+            return result;
+        }
+
+        /**
+         * The positions around center that satisfy pred.
+         */
+        template <typename Pred>
+        [[nodiscard]] constexpr neighbor_list<P, N> around_if(const P &center, Pred pred) const {
+            neighbor_list<P, N> result;
+            for (const auto &offset: offsets) {
+                auto p = center + offset;
+                if (pred(p)) {
+                    result.push_back(p);
+                }
+            }
+            return result;
+        }
+
+        /**
+         * The positions around center that are inside bounds, for any bounds type with a contains(P) member.
+         */
+        template <typename Bounds>
+        [[nodiscard]] constexpr neighbor_list<P, N> around_within(const P &center, const Bounds &bounds) const {
+            return around_if(center, [&](const P &p) { return bounds.contains(p); });
+        }
+    };
 }